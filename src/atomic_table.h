@@ -0,0 +1,221 @@
+#ifndef SANS_ATOMIC_TABLE_H
+#define SANS_ATOMIC_TABLE_H
+
+
+#include <atomic>
+#include <cstdint>
+
+
+using namespace std;
+
+/**
+ * This class is a concurrent open-addressing hash table mapping keys to color bits, without locks.
+ * A slot is claimed by CAS on its state, and colors are set by atomic fetch_or on the color words.
+ * When the table gets full, a table of twice the size is prepended, and new keys go there. A key may
+ * then be stored in several of the tables, which are merged when all keys are inserted (see merge).
+ */
+template <typename K, uint64_t W>
+class atomic_table {
+
+private:
+
+    /**
+     * These are the states of a slot.
+     */
+    static const uint8_t empty = 0;
+    static const uint8_t busy = 1;    // claimed, the key is being written
+    static const uint8_t ready = 2;
+
+    /**
+     * This is a slot of a table.
+     */
+    struct slot {
+        atomic<uint8_t> state;
+        K key;
+        uint64_t colors[W];
+    };
+
+    /**
+     * This is a table and the older (smaller) tables.
+     */
+    struct level {
+        slot* slots;
+        uint64_t mask;    // the capacity minus one, a power of two
+        atomic<uint64_t> size;
+        level* next;
+
+        level(uint64_t capacity, level* next) : slots(new slot[capacity]()), mask(capacity-1), size(0), next(next) {}
+        ~level() {delete[] slots;}
+    };
+
+    /**
+     * This is the newest table.
+     */
+    atomic<level*> head;
+
+    /**
+     * This function finds the slot of a key, or claims a free one for it.
+     *
+     * @param key key
+     * @param hash hash value of the key
+     * @return slot of the key
+     */
+    slot& claim(const K& key, const uint64_t& hash) {
+        level* current = head.load(memory_order_acquire);
+        while (true) {
+            uint64_t limit = current->mask - current->mask / 4;    // max. load of 3/4
+            for (uint64_t i = hash & current->mask, n = 0; n <= current->mask; i = (i+1) & current->mask, ++n) {
+                slot& next = current->slots[i];
+                uint8_t state = next.state.load(memory_order_acquire);
+                if (state == empty) {
+                    if (current->size.load(memory_order_relaxed) >= limit) break;    // full, grow
+                    if (next.state.compare_exchange_strong(state, busy, memory_order_acquire)) {
+                        next.key = key;
+                        next.state.store(ready, memory_order_release);
+                        current->size.fetch_add(1, memory_order_relaxed);
+                        return next;
+                    }
+                }
+                while (state == busy) {    // wait until the key is written
+                    #if defined(__i386__) || defined(__x86_64__)
+                        __builtin_ia32_pause();
+                    #endif
+                    state = next.state.load(memory_order_acquire);
+                }
+                if (next.key == key) return next;
+            }
+            current = grow(current);
+        }
+    }
+
+    /**
+     * This function prepends a table of twice the size, unless another thread did.
+     *
+     * @param full table that is full
+     * @return newest table
+     */
+    level* grow(level* full) {
+        level* current = head.load(memory_order_acquire);
+        if (current != full) return current;
+        level* bigger = new level(2 * (full->mask + 1), full);
+        if (head.compare_exchange_strong(current, bigger, memory_order_acq_rel)) return bigger;
+        delete bigger;
+        return current;
+    }
+
+public:
+
+    /**
+     * This function creates an empty table.
+     *
+     * @param capacity initial number of slots (a power of two)
+     */
+    atomic_table(uint64_t capacity = 16) {
+        head.store(new level(capacity, nullptr), memory_order_relaxed);
+    }
+
+    ~atomic_table() {
+        level* current = head.load(memory_order_relaxed);
+        while (current) {
+            level* next = current->next;
+            delete current;
+            current = next;
+        }
+    }
+
+    atomic_table(const atomic_table&) = delete;
+    atomic_table& operator=(const atomic_table&) = delete;
+
+    /**
+     * This function sets a color of a key, the key is inserted if necessary.
+     *
+     * @param key key
+     * @param hash hash value of the key
+     * @param color color index
+     */
+    void insert(const K& key, const uint64_t& hash, const uint16_t& color) {
+        slot& entry = claim(key, hash);
+        __atomic_fetch_or(&entry.colors[color / 64], 1ULL << (color % 64), __ATOMIC_RELAXED);
+    }
+
+    /**
+     * This function sets a color of a key, the key is inserted if necessary.
+     *
+     * @param key key
+     * @param color color index
+     */
+    void insert(const K& key, const uint16_t& color) {
+        insert(key, std::hash<K>()(key), color);
+    }
+
+    /**
+     * This function fetches the first slot probed for a key into the cache, ahead of its insertion.
+     *
+     * @param hash hash value of the key
+     */
+    void prefetch(const uint64_t& hash) const {
+        level* current = head.load(memory_order_relaxed);
+        __builtin_prefetch(&current->slots[hash & current->mask], 1);
+    }
+
+    /**
+     * This function merges the older tables into the newest one, the colors of a key are united.
+     * It must not be called concurrently with insert.
+     */
+    void merge() {
+        level* newest = head.load(memory_order_acquire);
+        level* older = newest->next;
+        newest->next = nullptr;
+        while (older) {
+            for (uint64_t i = 0; i <= older->mask; ++i) {
+                slot& old = older->slots[i];
+                if (old.state.load(memory_order_relaxed) != ready) continue;
+                slot& entry = claim(old.key, std::hash<K>()(old.key));    // may grow the table again
+                for (uint64_t w = 0; w < W; ++w) {entry.colors[w] |= old.colors[w];}
+            }
+            level* next = older->next;
+            delete older;
+            older = next;
+        }
+        if (head.load(memory_order_acquire)->next) merge();    // the table has grown while merging
+    }
+
+    /**
+     * This function removes all keys and frees the tables.
+     * It must not be called concurrently with insert.
+     */
+    void clear() {
+        level* current = head.exchange(new level(16, nullptr), memory_order_acq_rel);
+        while (current) {
+            level* next = current->next;
+            delete current;
+            current = next;
+        }
+    }
+
+    /**
+     * This function calls a function for each key and its color words, after the tables are merged.
+     *
+     * @param func function of the key and color words
+     */
+    template <typename F>
+    void for_each(F func) const {
+        level* current = head.load(memory_order_acquire);
+        for (uint64_t i = 0; i <= current->mask; ++i) {
+            const slot& entry = current->slots[i];
+            if (entry.state.load(memory_order_relaxed) == ready) func(entry.key, entry.colors);
+        }
+    }
+
+    /**
+     * This function returns the number of keys, after the tables are merged.
+     *
+     * @return number of keys
+     */
+    uint64_t size() const {
+        return head.load(memory_order_acquire)->size.load(memory_order_relaxed);
+    }
+
+};
+
+#endif
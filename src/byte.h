@@ -1,4 +1,7 @@
 #include <cstdint>
+#include <cstddef>
+#include "hash.h"
+#include "cpu.h"
 
 #if !defined(CLASS_NAME) // must be defined in the including header
     #error "CLASS_NAME is not defined (byte.h)"
@@ -28,9 +31,12 @@
 #elif BIT_LENGTH <= 32
     #define STORAGE_BITS 32
     typedef uint_least32_t STORAGE_TYPE;
-#else // _LENGTH <= 64
+#elif BIT_LENGTH <= 64 || BIT_LENGTH > 128 || !defined(INT128_STORAGE) || !defined(__SIZEOF_INT128__)
     #define STORAGE_BITS 64
     typedef uint_least64_t STORAGE_TYPE;
+#else // _LENGTH <= 128, a single word instead of an array of two, if requested by the including header
+    #define STORAGE_BITS 128
+    typedef __uint128_t STORAGE_TYPE __attribute__((aligned(8)));    // packed as tightly as an array in the tables
 #endif
 
 #if BIT_LENGTH <= 255
@@ -43,7 +49,11 @@
     typedef uint_fast64_t INDEX_TYPE;
 #endif
 
-#define MAX_STORAGE_BITS 64 // threshold to switch from single to array representation
+#if STORAGE_BITS == 128
+    #define MAX_STORAGE_BITS 128
+#else
+    #define MAX_STORAGE_BITS 64 // threshold to switch from single to array representation
+#endif
 #define ARRAY_LENGTH ((BIT_LENGTH / STORAGE_BITS) + (bool)(BIT_LENGTH % STORAGE_BITS))
 
 #if defined(__has_include)
@@ -57,6 +67,12 @@
                 #elif STORAGE_BITS <= 64
                     #define _popcnt(_X) _mm_popcnt_u64(_X)
                 #endif
+            #else // detected at runtime
+                #if STORAGE_BITS <= 32
+                    #define _popcnt(_X) cpu::popcnt32(_X)
+                #elif STORAGE_BITS <= 64
+                    #define _popcnt(_X) cpu::popcnt64(_X)
+                #endif
             #endif
             #if defined(__BMI__)
                 #if STORAGE_BITS <= 32
@@ -64,6 +80,12 @@
                 #elif STORAGE_BITS <= 64
                     #define _tzcnt(_X) (_X? _tzcnt_u64(_X): STORAGE_BITS)
                 #endif
+            #else // bit scan (BSF), available on any x86 CPU
+                #if STORAGE_BITS <= 32
+                    #define _tzcnt(_X) (_X? __builtin_ctz(_X): STORAGE_BITS)
+                #elif STORAGE_BITS <= 64
+                    #define _tzcnt(_X) (_X? __builtin_ctzll(_X): STORAGE_BITS)
+                #endif
             #endif
             #if defined(__BMI2__)
                 #if STORAGE_BITS <= 32
@@ -73,6 +95,11 @@
                     #define _pext(_X,_Y) _pext_u64(_X,_Y)
                     #define _pdep(_X,_Y) _pdep_u64(_X,_Y)
                 #endif
+            #else // detected at runtime
+                #if STORAGE_BITS <= 64
+                    #define _pext(_X,_Y) ((STORAGE_TYPE) cpu::pext64(_X,_Y))
+                    #define _pdep(_X,_Y) ((STORAGE_TYPE) cpu::pdep64(_X,_Y))
+                #endif
             #endif
 
         #endif
@@ -92,6 +119,11 @@
     #endif
 #endif
 
+#if STORAGE_BITS == 128 // two halves
+    #define _popcnt(_X) (cpu::popcnt64((uint64_t) (_X)) + cpu::popcnt64((uint64_t) ((_X) >> 64)))
+    #define _tzcnt(_X) ((uint64_t) (_X)? __builtin_ctzll((uint64_t) (_X)): (_X)? 64 + __builtin_ctzll((uint64_t) ((_X) >> 64)): 128)
+#endif
+
 #if !defined(_popcnt)
     #define _popcnt(_X)\
     [] (const STORAGE_TYPE& X) -> INDEX_TYPE {\
@@ -131,8 +163,18 @@
         } return _byte; } (_X,_Y)
 #endif
 
+#if defined(BYTE_NAMESPACE) // optional namespace of the class, defined in the including header
+    #define QUALIFIED_NAME BYTE_NAMESPACE::CLASS_NAME
+#else
+    #define QUALIFIED_NAME CLASS_NAME
+#endif
+
 // ############################ BEGIN CLASS DEFINITION ############################ //
 
+#if defined(BYTE_NAMESPACE)
+namespace BYTE_NAMESPACE {
+#endif
+
 class CLASS_NAME {
  private:
    #if BIT_LENGTH <= MAX_STORAGE_BITS
@@ -386,6 +428,13 @@ class CLASS_NAME {
        #endif
         return *this;
     }
+    constexpr const STORAGE_TYPE* data() const noexcept {    // the words, e.g., for vectorized functions
+       #if BIT_LENGTH <= MAX_STORAGE_BITS
+         return &byte;
+       #else
+         return byte;
+       #endif
+    }
     constexpr bool test(const INDEX_TYPE& pos) const noexcept {
        #if BIT_LENGTH <= MAX_STORAGE_BITS
          return byte & ((STORAGE_TYPE) 1 << pos);
@@ -596,14 +645,20 @@ constexpr STORAGE_TYPE operator%(const STORAGE_TYPE& value) const noexcept {
     }
 };
 
-template<> struct std::hash<CLASS_NAME> {
-    constexpr STORAGE_TYPE operator()(const CLASS_NAME& obj) const noexcept {
-       #if BIT_LENGTH <= MAX_STORAGE_BITS
-         return obj.byte;
+#if defined(BYTE_NAMESPACE)
+}
+#endif
+
+template<> struct std::hash<QUALIFIED_NAME> {
+    inline size_t operator()(const QUALIFIED_NAME& obj) const noexcept {
+       #if STORAGE_BITS == 128
+         return hasher::combine(hasher::mix((uint64_t) obj.byte), (uint64_t) (obj.byte >> 64));
+       #elif BIT_LENGTH <= MAX_STORAGE_BITS
+         return hasher::mix(obj.byte);
        #else
-         STORAGE_TYPE hash = obj.byte[0];
+         uint64_t hash = hasher::mix(obj.byte[0]);
          for (INDEX_TYPE i = 1; i != ARRAY_LENGTH; ++i)
-             hash ^= obj.byte[i];
+             hash = hasher::combine(hash, obj.byte[i]);
          return hash;
        #endif
     }
@@ -613,6 +668,9 @@ template<> struct std::hash<CLASS_NAME> {
 #undef STORAGE_TYPE
 #undef INDEX_TYPE
 #undef BIT_LENGTH
+#undef BYTE_NAMESPACE
+#undef INT128_STORAGE
+#undef QUALIFIED_NAME
 
 #undef STORAGE_BITS
 #undef MAX_STORAGE_BITS
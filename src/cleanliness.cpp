@@ -1,5 +1,7 @@
 #include "cleanliness.h"
 
+BEGIN_WIDTH
+
 
 void cleanliness::init() {
 }
@@ -54,4 +56,6 @@ void cleanliness::reportCleanliness() {
     } else {
         cout  << endl;
     }
-}
\ No newline at end of file
+}
+
+END_WIDTH
@@ -3,6 +3,8 @@
 
 #include "graph.h"
 
+BEGIN_WIDTH
+
 /**
  * This struct saves unfiltered and filtered split values to compare
  * them after filtering so we don't need to save the entire unfiltered list.
@@ -96,4 +98,6 @@ public:
 };
 
 
+END_WIDTH
+
 #endif //SANS_CLEANLINESS_H
@@ -1,5 +1,11 @@
 #include "color.h"
 
+#if defined(__x86_64__)
+    #include <immintrin.h>
+#endif
+
+BEGIN_WIDTH
+
 /*
  * This class contains functions for working with color types.
  */
@@ -7,7 +13,13 @@ size1N_t color::n;      // number of colors
 color_t  color::mask;   // bit-mask to erase all bits that exceed the color number
 
 /**
- * This function initializes the color number and bit-mask.
+ * These are the vectorized or the scalar compatibility tests.
+ */
+bool (*color::compatible)(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* m) = color::compatible_scalar;
+bool (*color::weakly_compatible)(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* c3, const uint1N_t* m) = color::weakly_compatible_scalar;
+
+/**
+ * This function initializes the color number and bit-mask, and chooses the compatibility tests.
  *
  * @param number color number
  */
@@ -15,6 +27,19 @@ void color::init(const size1N_t& number) {
     n = number; mask = 0b0u;
     for (size1N_t i = 0; i < n; ++i)  // fill all bits within the color number with ones
         (mask <<= 01u) |= 0b1u;      // the remaining zero bits can be used to mask bits
+
+    compatible = compatible_scalar;
+    weakly_compatible = weakly_compatible_scalar;
+#if defined(__x86_64__) && maxN > 64
+    __builtin_cpu_init();
+    if (words >= 8 && __builtin_cpu_supports("avx512f")) {
+        compatible = compatible_avx512;
+        weakly_compatible = weakly_compatible_avx512;
+    } else if (words >= 4 && __builtin_cpu_supports("avx2")) {
+        compatible = compatible_avx2;
+        weakly_compatible = weakly_compatible_avx2;
+    }
+#endif
 }
 
 /**
@@ -73,8 +98,7 @@ bool color::represent(color_t& color) {
  * @return true, if compatible
  */
 bool color::is_compatible(const color_t& c1, const color_t& c2) {
-    color_t n1 = ~c1 & mask, n2 = ~c2 & mask; using _ = color_t;
-    return (_::disjoint(c1, c2) || _::disjoint(c1, n2) || _::disjoint(n1, c2) || _::disjoint(n1, n2));
+    return compatible(c1.data(), c2.data(), mask.data());
 }
 
 /**
@@ -86,11 +110,186 @@ bool color::is_compatible(const color_t& c1, const color_t& c2) {
  * @return true, if weakly compatible
  */
 bool color::is_weakly_compatible(const color_t& c1, const color_t& c2, const color_t& c3) {
-    color_t n1 = ~c1 & mask, n2 = ~c2 & mask, n3 = ~c3 & mask; using _ = color_t;
-    return (_::disjoint(c1, c2, c3) || _::disjoint(c1, n2, n3) || _::disjoint(n1, c2, n3) || _::disjoint(n1, n2, c3))
-        && (_::disjoint(n1, n2, n3) || _::disjoint(n1, c2, c3) || _::disjoint(c1, n2, c3) || _::disjoint(c1, c2, n3));
+    return weakly_compatible(c1.data(), c2.data(), c3.data(), mask.data());
+}
+
+/**
+ * This function tests if two splits of colors are compatible, i.e., if one of the four intersections
+ * of the sets and their complements is empty. The intersections are collected word by word.
+ *
+ * @param c1 words of the first color set
+ * @param c2 words of the second color set
+ * @param m words of the bit-mask
+ * @return true, if compatible
+ */
+bool color::compatible_scalar(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* m) {
+    uint1N_t x11 = 0, x10 = 0, x01 = 0, x00 = 0;    // 1: the set, 0: its complement
+    for (size1N_t i = 0; i != words; ++i) {
+        x11 |= c1[i] & c2[i];
+        x10 |= c1[i] & ~c2[i] & m[i];
+        x01 |= ~c1[i] & c2[i] & m[i];
+        x00 |= ~(c1[i] | c2[i]) & m[i];
+    }
+    return !x11 || !x10 || !x01 || !x00;
+}
+
+/**
+ * This function tests if three splits of colors are weakly compatible, i.e., if one of four intersections
+ * and one of four other intersections of the sets and their complements is empty (see is_weakly_compatible).
+ *
+ * @param c1 words of the first color set
+ * @param c2 words of the second color set
+ * @param c3 words of the third color set
+ * @param m words of the bit-mask
+ * @return true, if weakly compatible
+ */
+bool color::weakly_compatible_scalar(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* c3, const uint1N_t* m) {
+    uint1N_t x111 = 0, x100 = 0, x010 = 0, x001 = 0;    // 1: the set, 0: its complement
+    uint1N_t x000 = 0, x011 = 0, x101 = 0, x110 = 0;
+    for (size1N_t i = 0; i != words; ++i) {
+        uint1N_t a = c1[i], b = c2[i], c = c3[i], na = ~a & m[i], nb = ~b & m[i], nc = ~c & m[i];
+        x111 |= a & b & c;    x000 |= na & nb & nc;
+        x100 |= a & nb & nc;  x011 |= na & b & c;
+        x010 |= na & b & nc;  x101 |= a & nb & c;
+        x001 |= na & nb & c;  x110 |= a & b & nc;
+    }
+    return (!x111 || !x100 || !x010 || !x001) && (!x000 || !x011 || !x101 || !x110);
+}
+
+#if defined(__x86_64__) && maxN > 64
+
+/**
+ * This function tests if two splits of colors are compatible, four words at a time (see compatible_scalar).
+ *
+ * @param c1 words of the first color set
+ * @param c2 words of the second color set
+ * @param m words of the bit-mask
+ * @return true, if compatible
+ */
+__attribute__((target("avx2")))
+bool color::compatible_avx2(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* m) {
+    __m256i x11 = _mm256_setzero_si256(), x10 = x11, x01 = x11, x00 = x11;
+    for (size1N_t i = 0; i < words - words % 4; i += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (c1 + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*) (c2 + i));
+        __m256i k = _mm256_loadu_si256((const __m256i*) (m + i));
+        x11 = _mm256_or_si256(x11, _mm256_and_si256(a, b));
+        x10 = _mm256_or_si256(x10, _mm256_andnot_si256(b, _mm256_and_si256(a, k)));
+        x01 = _mm256_or_si256(x01, _mm256_andnot_si256(a, _mm256_and_si256(b, k)));
+        x00 = _mm256_or_si256(x00, _mm256_andnot_si256(_mm256_or_si256(a, b), k));
+    }
+    uint1N_t y11 = 0, y10 = 0, y01 = 0, y00 = 0;
+    for (size1N_t i = words - words % 4; i < words; ++i) {
+        y11 |= c1[i] & c2[i];
+        y10 |= c1[i] & ~c2[i] & m[i];
+        y01 |= ~c1[i] & c2[i] & m[i];
+        y00 |= ~(c1[i] | c2[i]) & m[i];
+    }
+    return (_mm256_testz_si256(x11, x11) && !y11) || (_mm256_testz_si256(x10, x10) && !y10)
+        || (_mm256_testz_si256(x01, x01) && !y01) || (_mm256_testz_si256(x00, x00) && !y00);
+}
+
+/**
+ * This function tests if three splits of colors are weakly compatible, four words at a time (see weakly_compatible_scalar).
+ *
+ * @param c1 words of the first color set
+ * @param c2 words of the second color set
+ * @param c3 words of the third color set
+ * @param m words of the bit-mask
+ * @return true, if weakly compatible
+ */
+__attribute__((target("avx2")))
+bool color::weakly_compatible_avx2(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* c3, const uint1N_t* m) {
+    __m256i x111 = _mm256_setzero_si256(), x100 = x111, x010 = x111, x001 = x111;
+    __m256i x000 = x111, x011 = x111, x101 = x111, x110 = x111;
+    for (size1N_t i = 0; i < words - words % 4; i += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (c1 + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*) (c2 + i));
+        __m256i c = _mm256_loadu_si256((const __m256i*) (c3 + i));
+        __m256i k = _mm256_loadu_si256((const __m256i*) (m + i));
+        __m256i na = _mm256_andnot_si256(a, k), nb = _mm256_andnot_si256(b, k), nc = _mm256_andnot_si256(c, k);
+        __m256i ab = _mm256_and_si256(a, b), nab = _mm256_and_si256(na, b), anb = _mm256_and_si256(a, nb), nanb = _mm256_and_si256(na, nb);
+        x111 = _mm256_or_si256(x111, _mm256_and_si256(ab, c));    x000 = _mm256_or_si256(x000, _mm256_and_si256(nanb, nc));
+        x100 = _mm256_or_si256(x100, _mm256_and_si256(anb, nc));  x011 = _mm256_or_si256(x011, _mm256_and_si256(nab, c));
+        x010 = _mm256_or_si256(x010, _mm256_and_si256(nab, nc));  x101 = _mm256_or_si256(x101, _mm256_and_si256(anb, c));
+        x001 = _mm256_or_si256(x001, _mm256_and_si256(nanb, c));  x110 = _mm256_or_si256(x110, _mm256_and_si256(ab, nc));
+    }
+    uint1N_t y111 = 0, y100 = 0, y010 = 0, y001 = 0;
+    uint1N_t y000 = 0, y011 = 0, y101 = 0, y110 = 0;
+    for (size1N_t i = words - words % 4; i < words; ++i) {
+        uint1N_t a = c1[i], b = c2[i], c = c3[i], na = ~a & m[i], nb = ~b & m[i], nc = ~c & m[i];
+        y111 |= a & b & c;    y000 |= na & nb & nc;
+        y100 |= a & nb & nc;  y011 |= na & b & c;
+        y010 |= na & b & nc;  y101 |= a & nb & c;
+        y001 |= na & nb & c;  y110 |= a & b & nc;
+    }
+    return ((_mm256_testz_si256(x111, x111) && !y111) || (_mm256_testz_si256(x100, x100) && !y100)
+         || (_mm256_testz_si256(x010, x010) && !y010) || (_mm256_testz_si256(x001, x001) && !y001))
+        && ((_mm256_testz_si256(x000, x000) && !y000) || (_mm256_testz_si256(x011, x011) && !y011)
+         || (_mm256_testz_si256(x101, x101) && !y101) || (_mm256_testz_si256(x110, x110) && !y110));
+}
+
+/**
+ * This function tests if two splits of colors are compatible, eight words at a time (see compatible_scalar).
+ * The last words are loaded masked, so there is no scalar remainder.
+ *
+ * @param c1 words of the first color set
+ * @param c2 words of the second color set
+ * @param m words of the bit-mask
+ * @return true, if compatible
+ */
+__attribute__((target("avx512f")))
+bool color::compatible_avx512(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* m) {
+    __m512i x11 = _mm512_setzero_si512(), x10 = x11, x01 = x11, x00 = x11;
+    for (size1N_t i = 0; i < words; i += 8) {
+        __mmask8 load = words - i >= 8 ? 0xFF : (1u << (words - i)) - 1;
+        __m512i a = _mm512_maskz_loadu_epi64(load, c1 + i);
+        __m512i b = _mm512_maskz_loadu_epi64(load, c2 + i);
+        __m512i k = _mm512_maskz_loadu_epi64(load, m + i);
+        x11 = _mm512_or_si512(x11, _mm512_and_si512(a, b));
+        x10 = _mm512_or_si512(x10, _mm512_andnot_si512(b, _mm512_and_si512(a, k)));
+        x01 = _mm512_or_si512(x01, _mm512_andnot_si512(a, _mm512_and_si512(b, k)));
+        x00 = _mm512_or_si512(x00, _mm512_andnot_si512(_mm512_or_si512(a, b), k));
+    }
+    return !_mm512_test_epi64_mask(x11, x11) || !_mm512_test_epi64_mask(x10, x10)
+        || !_mm512_test_epi64_mask(x01, x01) || !_mm512_test_epi64_mask(x00, x00);
 }
 
+/**
+ * This function tests if three splits of colors are weakly compatible, eight words at a time (see weakly_compatible_scalar).
+ * The last words are loaded masked, so there is no scalar remainder.
+ *
+ * @param c1 words of the first color set
+ * @param c2 words of the second color set
+ * @param c3 words of the third color set
+ * @param m words of the bit-mask
+ * @return true, if weakly compatible
+ */
+__attribute__((target("avx512f")))
+bool color::weakly_compatible_avx512(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* c3, const uint1N_t* m) {
+    __m512i x111 = _mm512_setzero_si512(), x100 = x111, x010 = x111, x001 = x111;
+    __m512i x000 = x111, x011 = x111, x101 = x111, x110 = x111;
+    for (size1N_t i = 0; i < words; i += 8) {
+        __mmask8 load = words - i >= 8 ? 0xFF : (1u << (words - i)) - 1;
+        __m512i a = _mm512_maskz_loadu_epi64(load, c1 + i);
+        __m512i b = _mm512_maskz_loadu_epi64(load, c2 + i);
+        __m512i c = _mm512_maskz_loadu_epi64(load, c3 + i);
+        __m512i k = _mm512_maskz_loadu_epi64(load, m + i);
+        __m512i na = _mm512_andnot_si512(a, k), nb = _mm512_andnot_si512(b, k), nc = _mm512_andnot_si512(c, k);
+        __m512i ab = _mm512_and_si512(a, b), nab = _mm512_and_si512(na, b), anb = _mm512_and_si512(a, nb), nanb = _mm512_and_si512(na, nb);
+        x111 = _mm512_or_si512(x111, _mm512_and_si512(ab, c));    x000 = _mm512_or_si512(x000, _mm512_and_si512(nanb, nc));
+        x100 = _mm512_or_si512(x100, _mm512_and_si512(anb, nc));  x011 = _mm512_or_si512(x011, _mm512_and_si512(nab, c));
+        x010 = _mm512_or_si512(x010, _mm512_and_si512(nab, nc));  x101 = _mm512_or_si512(x101, _mm512_and_si512(anb, c));
+        x001 = _mm512_or_si512(x001, _mm512_and_si512(nanb, c));  x110 = _mm512_or_si512(x110, _mm512_and_si512(ab, nc));
+    }
+    return (!_mm512_test_epi64_mask(x111, x111) || !_mm512_test_epi64_mask(x100, x100)
+         || !_mm512_test_epi64_mask(x010, x010) || !_mm512_test_epi64_mask(x001, x001))
+        && (!_mm512_test_epi64_mask(x000, x000) || !_mm512_test_epi64_mask(x011, x011)
+         || !_mm512_test_epi64_mask(x101, x101) || !_mm512_test_epi64_mask(x110, x110));
+}
+
+#endif
+
 /**
 * This function tests whether a given color set is the complete set of colors.
 * 
@@ -112,3 +311,4 @@ bool color::is_singleton(const color_t& c){
 	return c.popcnt()==1;
 }
 
+END_WIDTH
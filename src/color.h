@@ -5,6 +5,11 @@ using namespace std;
 #define maxN 64  // as preprocessor directive
 #endif
 
+#include "width.h"
+#if defined(WIDTHS)
+    #define BYTE_NAMESPACE WIDTH_NAME(maxK, maxN)
+#endif
+
 #define CLASS_NAME   color_t
 #define STORAGE_TYPE uint1N_t
 #define INDEX_TYPE   size1N_t
@@ -12,6 +17,8 @@ using namespace std;
 #define SET_ELEMENT_COMPARATORS
 #include "byte.h"
 
+BEGIN_WIDTH
+
 /**
  * This class contains functions for working with color types.
  */
@@ -24,6 +31,30 @@ class color {
      */
     static color_t mask;
 
+    /**
+     * This is the number of words of a color set.
+     */
+    static const size1N_t words = sizeof(color_t) / sizeof(uint1N_t);
+
+    /**
+     * These are the vectorized or the scalar compatibility tests (see is_compatible, is_weakly_compatible).
+     */
+    static bool (*compatible)(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* m);
+    static bool (*weakly_compatible)(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* c3, const uint1N_t* m);
+
+    /**
+     * These functions test the compatibility word by word, or vectorized for color sets of several words.
+     * All disjointness tests are fused into one sweep, without constructing the complements.
+     */
+    static bool compatible_scalar(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* m);
+    static bool weakly_compatible_scalar(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* c3, const uint1N_t* m);
+  #if defined(__x86_64__) && maxN > 64
+    static bool compatible_avx2(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* m);
+    static bool weakly_compatible_avx2(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* c3, const uint1N_t* m);
+    static bool compatible_avx512(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* m);
+    static bool weakly_compatible_avx512(const uint1N_t* c1, const uint1N_t* c2, const uint1N_t* c3, const uint1N_t* m);
+  #endif
+
  public:
 
     /**
@@ -108,3 +139,5 @@ class color {
  protected:
 
 };
+
+END_WIDTH
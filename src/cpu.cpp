@@ -0,0 +1,13 @@
+#include "cpu.h"
+
+
+/**
+ * These flags indicate whether the CPU supports the instructions, they are set before main is called.
+ */
+#if defined(__x86_64__)
+    const bool cpu::has_popcnt = (__builtin_cpu_init(), __builtin_cpu_supports("popcnt"));
+    const bool cpu::has_bmi2 = (__builtin_cpu_init(), __builtin_cpu_supports("bmi2"));
+#else
+    const bool cpu::has_popcnt = false;
+    const bool cpu::has_bmi2 = false;
+#endif
@@ -0,0 +1,106 @@
+#ifndef SANS_CPU_H
+#define SANS_CPU_H
+
+
+#include <cstdint>
+
+
+/**
+ * This class provides bit operations using the instructions of the CPU at hand (POPCNT, BMI2), if supported.
+ * The binary is compiled for a generic x86-64 CPU (-mtune=native, not -march=native), so these instructions are
+ * not available at compile time. Instead, their support is detected once at startup, and the functions are
+ * inlined with a well-predicted branch to the instruction or to a portable fallback.
+ */
+class cpu {
+
+public:
+
+    /**
+     * These flags indicate whether the CPU supports the instructions.
+     */
+    static const bool has_popcnt;
+    static const bool has_bmi2;
+
+    /**
+     * This function counts the set bits of a word.
+     *
+     * @param x word
+     * @return number of set bits
+     */
+    static inline uint64_t popcnt64(const uint64_t& x) {
+        #if defined(__x86_64__)
+            if (has_popcnt) {
+                uint64_t count;
+                __asm__ ("popcnt %1, %0" : "=r" (count) : "r" (x));
+                return count;
+            }
+        #endif
+        return __builtin_popcountll(x);
+    }
+
+    /**
+     * This function counts the set bits of a (half) word.
+     *
+     * @param x word
+     * @return number of set bits
+     */
+    static inline uint32_t popcnt32(const uint32_t& x) {
+        #if defined(__x86_64__)
+            if (has_popcnt) {
+                uint32_t count;
+                __asm__ ("popcnt %1, %0" : "=r" (count) : "r" (x));
+                return count;
+            }
+        #endif
+        return __builtin_popcount(x);
+    }
+
+    /**
+     * This function extracts the bits of a word at the set positions of a mask into the low bits.
+     *
+     * @param x word
+     * @param mask bit mask
+     * @return extracted bits
+     */
+    static inline uint64_t pext64(const uint64_t& x, const uint64_t& mask) {
+        #if defined(__x86_64__)
+            if (has_bmi2) {
+                uint64_t bits;
+                __asm__ ("pext %2, %1, %0" : "=r" (bits) : "r" (x), "r" (mask));
+                return bits;
+            }
+        #endif
+        uint64_t bits = 0, rest = mask;
+        for (uint64_t pos = 1; rest; pos <<= 1) {
+            if (x & rest & -rest) bits |= pos;
+            rest &= rest-1;
+        }
+        return bits;
+    }
+
+    /**
+     * This function deposits the low bits of a word at the set positions of a mask.
+     *
+     * @param x word
+     * @param mask bit mask
+     * @return deposited bits
+     */
+    static inline uint64_t pdep64(const uint64_t& x, const uint64_t& mask) {
+        #if defined(__x86_64__)
+            if (has_bmi2) {
+                uint64_t bits;
+                __asm__ ("pdep %2, %1, %0" : "=r" (bits) : "r" (x), "r" (mask));
+                return bits;
+            }
+        #endif
+        uint64_t bits = 0, rest = mask;
+        for (uint64_t pos = 1; rest; pos <<= 1) {
+            if (x & pos) bits |= rest & -rest;
+            rest &= rest-1;
+        }
+        return bits;
+    }
+
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "dispatch.h"
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+
+
+/**
+ * This function returns the registered instances.
+ * It is a function-local static, such that it is initialized before the first registration.
+ *
+ * @return registered instances
+ */
+vector<dispatch::instance>& dispatch::instances() {
+    static vector<instance> registered;
+    return registered;
+}
+
+/**
+ * This function registers an instance.
+ *
+ * @param max_k max. length of DNA k-mers
+ * @param max_k_amino max. length of amino acid k-mers
+ * @param max_n max. number of colors
+ * @param entry entry point
+ */
+dispatch::width::width(const uint64_t& max_k, const uint64_t& max_k_amino, const uint64_t& max_n, entry_t entry) {
+    instances().push_back({max_k, max_k_amino, max_n, entry});
+}
+
+/**
+ * This function counts the genomes of the input list, i.e., its non-blank lines.
+ * Both the file-of-files and the kmtricks format list one genome per line.
+ *
+ * @param argc number of cmd args
+ * @param argv cmd args
+ * @return number of genomes (an upper bound), or 0 if there is no readable input list
+ */
+uint64_t dispatch::count_genomes(int argc, char* argv[]) {
+    string input;
+    for (int i = 1; i+1 < argc; ++i) {
+        if (strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--input") == 0) {
+            input = argv[++i];
+        }
+    }
+    if (input.empty()) return 0;
+
+    ifstream file(input);
+    uint64_t num = 0;
+    string line;
+    while (getline(file, line)) {
+        if (line.find_first_not_of(' ') != string::npos) num++;
+    }
+    return num;
+}
+
+/**
+ * This function calls the entry point of the smallest instance that fits the k-mer length and the input,
+ * or of the widest one if the input is a graph or exceeds all instances.
+ * The k-mer width is minimized first, as it determines the size of the hash tables.
+ *
+ * @param argc number of cmd args
+ * @param argv cmd args
+ * @return exit status
+ */
+int dispatch::run(int argc, char* argv[]) {
+    uint64_t num = count_genomes(argc, argv);
+    uint64_t kmer = 0;    // as in main: 31, or 10 for amino acids, if not specified
+    bool amino = false, graph = false;
+    for (int i = 1; i < argc; ++i) {
+        if ((strcmp(argv[i], "-k") == 0 || strcmp(argv[i], "--kmer") == 0) && i+1 < argc) {
+            kmer = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--amino") == 0 || strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--code") == 0) {
+            amino = true;
+        }
+        else if (strcmp(argv[i], "-g") == 0 || strcmp(argv[i], "--graph") == 0) {
+            graph = true;    // the k-mer length and the colors of a graph are not known in advance
+        }
+    }
+    if (kmer == 0) kmer = amino ? 10 : 31;
+
+    const instance* best = nullptr;
+    const instance* widest = nullptr;
+    for (const instance& next : instances()) {
+        if (!widest || (next.max_k >= widest->max_k && next.max_n >= widest->max_n)) widest = &next;
+        if (graph || (amino ? next.max_k_amino : next.max_k) < kmer || next.max_n < num) continue;
+        if (!best || next.max_k < best->max_k || (next.max_k == best->max_k && next.max_n < best->max_n)) best = &next;
+    }
+    return (best ? best : widest)->entry(argc, argv);
+}
+
+/**
+ * This is the entry point of the program.
+ *
+ * @param argc number of cmd args
+ * @param argv cmd args
+ * @return exit status
+ */
+int main(int argc, char* argv[]) {
+    return dispatch::run(argc, argv);
+}
@@ -0,0 +1,72 @@
+#ifndef SANS_DISPATCH_H
+#define SANS_DISPATCH_H
+
+
+#include <cstdint>
+#include <vector>
+
+
+using namespace std;
+
+/**
+ * This class chooses the k-mer and color width at runtime. The k-mer and color dependent code is compiled once per
+ * max. k-mer length and number of colors (see KEYS and WIDTHS in the makefile), each instance registers its entry
+ * point, and the entry point of the smallest instance that fits the k-mer length and the input genomes is called.
+ */
+class dispatch {
+
+private:
+
+    /**
+     * This is the type of an entry point.
+     */
+    typedef int (*entry_t)(int argc, char* argv[]);
+
+    /**
+     * This is a registered instance.
+     */
+    struct instance {
+        uint64_t max_k;          // max. length of DNA k-mers
+        uint64_t max_k_amino;    // max. length of amino acid k-mers
+        uint64_t max_n;          // max. number of colors
+        entry_t entry;
+    };
+
+    /**
+     * This function returns the registered instances.
+     *
+     * @return registered instances
+     */
+    static vector<instance>& instances();
+
+public:
+
+    /**
+     * This struct registers an instance when it is constructed (statically, before main is called).
+     */
+    struct width {
+        width(const uint64_t& max_k, const uint64_t& max_k_amino, const uint64_t& max_n, entry_t entry);
+    };
+
+    /**
+     * This function counts the genomes of the input list, i.e., its non-blank lines.
+     *
+     * @param argc number of cmd args
+     * @param argv cmd args
+     * @return number of genomes (an upper bound), or 0 if there is no readable input list
+     */
+    static uint64_t count_genomes(int argc, char* argv[]);
+
+    /**
+     * This function calls the entry point of the smallest instance that fits the k-mer length and the input,
+     * or of the widest one if the input is a graph or exceeds all instances.
+     *
+     * @param argc number of cmd args
+     * @param argv cmd args
+     * @return exit status
+     */
+    static int run(int argc, char* argv[]);
+
+};
+
+#endif
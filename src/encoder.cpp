@@ -0,0 +1,129 @@
+#include "encoder.h"
+#include "util.h"
+#include <cstring>
+#include <cctype>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+
+/**
+ * This is the binary code of each character, or invalid.
+ */
+uint8_t encoder::table[256];
+
+/**
+ * This is the vectorized or the scalar encoding function.
+ */
+void (*encoder::encode_block)(const char* str, const uint64_t& length, uint8_t* codes, uint64_t* invalid) = encoder::encode_scalar;
+
+/**
+ * This function initializes the look-up table and chooses the encoding function.
+ *
+ * @param allowed allowed (upper case) characters
+ * @param amino true, if amino acids are encoded
+ */
+void encoder::init(const vector<char>& allowed, const bool& amino) {
+    memset(table, invalid_code, sizeof(table));
+    for (const char& c : allowed) {
+        uint8_t code = amino ? util::amino_char_to_bits(c) : util::char_to_bits(c);
+        table[(uint8_t) c] = code;
+        table[(uint8_t) tolower(c)] = code;
+    }
+    encode_block = encode_scalar;
+
+#if defined(__x86_64__) || defined(__i386__)
+    // the vectorized functions are specific to the DNA alphabet
+    if (!amino && allowed == vector<char>{'A', 'C', 'G', 'T'}) {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            encode_block = encode_avx2;
+        } else if (__builtin_cpu_supports("sse4.1")) {
+            encode_block = encode_sse;
+        }
+    }
+#endif
+}
+
+/**
+ * This function encodes a piece using the look-up table.
+ *
+ * @param str first character
+ * @param length number of characters
+ * @param codes binary code of each character
+ * @param invalid bit mask of invalid positions
+ */
+void encoder::encode_scalar(const char* str, const uint64_t& length, uint8_t* codes, uint64_t* invalid) {
+    memset(invalid, 0, (length + 63) / 64 * sizeof(uint64_t));
+    for (uint64_t pos = 0; pos < length; ++pos) {
+        codes[pos] = table[(uint8_t) str[pos]];
+        invalid[pos / 64] |= (uint64_t) (codes[pos] == invalid_code) << (pos % 64);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * This function encodes a piece of DNA, 16 characters at a time.
+ * Upper case ACGT are identified by comparison, their low nibbles (1, 3, 7, 4) look up the codes.
+ *
+ * @param str first character
+ * @param length number of characters
+ * @param codes binary code of each character
+ * @param invalid bit mask of invalid positions
+ */
+__attribute__((target("sse4.1")))
+void encoder::encode_sse(const char* str, const uint64_t& length, uint8_t* codes, uint64_t* invalid) {
+    memset(invalid, 0, (length + 63) / 64 * sizeof(uint64_t));
+    const __m128i fold = _mm_set1_epi8((char) 0xDF);    // clears the lower case bit
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i lookup = _mm_setr_epi8(0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i A = _mm_set1_epi8('A'), C = _mm_set1_epi8('C'), G = _mm_set1_epi8('G'), T = _mm_set1_epi8('T');
+
+    uint64_t pos = 0;
+    for (; pos + 16 <= length; pos += 16) {
+        __m128i upper = _mm_and_si128(_mm_loadu_si128((const __m128i*) (str + pos)), fold);
+        __m128i valid = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(upper, A), _mm_cmpeq_epi8(upper, C)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(upper, G), _mm_cmpeq_epi8(upper, T)));
+        _mm_storeu_si128((__m128i*) (codes + pos), _mm_shuffle_epi8(lookup, _mm_and_si128(upper, nibble)));
+        invalid[pos / 64] |= (uint64_t) (~_mm_movemask_epi8(valid) & 0xFFFF) << (pos % 64);
+    }
+    for (; pos < length; ++pos) {
+        codes[pos] = table[(uint8_t) str[pos]];
+        invalid[pos / 64] |= (uint64_t) (codes[pos] == invalid_code) << (pos % 64);
+    }
+}
+
+/**
+ * This function encodes a piece of DNA, 32 characters at a time (see encode_sse).
+ *
+ * @param str first character
+ * @param length number of characters
+ * @param codes binary code of each character
+ * @param invalid bit mask of invalid positions
+ */
+__attribute__((target("avx2")))
+void encoder::encode_avx2(const char* str, const uint64_t& length, uint8_t* codes, uint64_t* invalid) {
+    memset(invalid, 0, (length + 63) / 64 * sizeof(uint64_t));
+    const __m256i fold = _mm256_set1_epi8((char) 0xDF);    // clears the lower case bit
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i lookup = _mm256_setr_epi8(0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0,
+                                            0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i A = _mm256_set1_epi8('A'), C = _mm256_set1_epi8('C'), G = _mm256_set1_epi8('G'), T = _mm256_set1_epi8('T');
+
+    uint64_t pos = 0;
+    for (; pos + 32 <= length; pos += 32) {
+        __m256i upper = _mm256_and_si256(_mm256_loadu_si256((const __m256i*) (str + pos)), fold);
+        __m256i valid = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(upper, A), _mm256_cmpeq_epi8(upper, C)),
+                                        _mm256_or_si256(_mm256_cmpeq_epi8(upper, G), _mm256_cmpeq_epi8(upper, T)));
+        _mm256_storeu_si256((__m256i*) (codes + pos), _mm256_shuffle_epi8(lookup, _mm256_and_si256(upper, nibble)));
+        invalid[pos / 64] |= (uint64_t) (~(uint32_t) _mm256_movemask_epi8(valid)) << (pos % 64);
+    }
+    for (; pos < length; ++pos) {
+        codes[pos] = table[(uint8_t) str[pos]];
+        invalid[pos / 64] |= (uint64_t) (codes[pos] == invalid_code) << (pos % 64);
+    }
+}
+
+#endif
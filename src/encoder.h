@@ -0,0 +1,97 @@
+#ifndef SANS_ENCODER_H
+#define SANS_ENCODER_H
+
+
+#include <vector>
+#include <cstdint>
+
+
+using namespace std;
+
+/**
+ * This class encodes sequence pieces in one sweep: upper and lower case characters are translated to their
+ * binary codes (two bits for DNA, five bits for amino acids), and a bit mask marks the invalid positions.
+ * DNA is encoded using SSE4.1 or AVX2, if supported by the CPU, amino acids using a look-up table.
+ */
+class encoder {
+
+private:
+
+    /**
+     * This is the binary code of each character, or invalid.
+     */
+    static uint8_t table[256];
+
+    /**
+     * This is the vectorized or the scalar encoding function.
+     */
+    static void (*encode_block)(const char* str, const uint64_t& length, uint8_t* codes, uint64_t* invalid);
+
+    /**
+     * These functions encode a piece using the look-up table, or vectorized for DNA.
+     */
+    static void encode_scalar(const char* str, const uint64_t& length, uint8_t* codes, uint64_t* invalid);
+    static void encode_sse(const char* str, const uint64_t& length, uint8_t* codes, uint64_t* invalid);
+    static void encode_avx2(const char* str, const uint64_t& length, uint8_t* codes, uint64_t* invalid);
+
+public:
+
+    /**
+     * This is the code of an invalid character.
+     */
+    static const uint8_t invalid_code = 0xFF;
+
+    /**
+     * This function initializes the look-up table and chooses the encoding function.
+     *
+     * @param allowed allowed (upper case) characters
+     * @param amino true, if amino acids are encoded
+     */
+    static void init(const vector<char>& allowed, const bool& amino);
+
+    /**
+     * This function returns the binary code of a character.
+     *
+     * @param c upper or lower case character
+     * @return binary code, or invalid_code
+     */
+    static inline uint8_t code(const char& c) {
+        return table[(uint8_t) c];
+    }
+
+    /**
+     * This function encodes a piece of a sequence.
+     *
+     * @param str first character
+     * @param length number of characters
+     * @param codes binary code of each character (undefined at invalid positions)
+     * @param invalid bit mask of invalid positions, (length+63)/64 words
+     */
+    static inline void encode(const char* str, const uint64_t& length, uint8_t* codes, uint64_t* invalid) {
+        encode_block(str, length, codes, invalid);
+    }
+
+    /**
+     * This function finds the next position whose bit in the mask has the given value.
+     *
+     * @param invalid bit mask of invalid positions
+     * @param pos first position to check
+     * @param length number of positions
+     * @param set true, to find an invalid position, false, to find a valid one
+     * @return next such position, or length
+     */
+    static inline uint64_t next(const uint64_t* invalid, uint64_t pos, const uint64_t& length, const bool& set) {
+        while (pos < length) {
+            uint64_t word = (set ? invalid[pos / 64] : ~invalid[pos / 64]) >> (pos % 64);
+            if (word) {
+                pos += __builtin_ctzll(word);
+                return pos < length ? pos : length;
+            }
+            pos = (pos / 64 + 1) * 64;
+        }
+        return length;
+    }
+
+};
+
+#endif
@@ -4,6 +4,23 @@
 #include <thread>
 #include <algorithm>
 
+/**
+ * This is a comparison function extending std::bitset.
+ */ 
+#if (maxK > 12 || maxN > 64)
+namespace std {
+    template <size_t N>
+    bool operator<(const bitset<N>& x, const bitset<N>& y) {
+        for (uint64_t i = N-1; i != -1; --i) {
+            if (x[i] ^ y[i]) return y[i];
+        }
+        return false;
+    }
+}
+#endif
+
+BEGIN_WIDTH
+
 /**
  * This is the size of the top list.
  */
@@ -27,24 +44,51 @@ bool graph::isAmino;
 uint64_t graph::table_count;
 
 /**
- * This is a vecotr of spinlocks protecting the hash maps 
+ * This is a vecotr of spinlocks protecting the hash maps, one per group
  */
-vector<spinlock> graph::lock;
+vector<padded_spinlock> graph::lock;
 
 /**
- * This vector holds the carries of 2**i % table_count for fast distribution of binary represented kmers
+ * These are the k-mers of the current thread waiting to be inserted.
  */
-vector<uint_fast32_t> graph::period;
+thread_local insert_buffer<kmer_t> graph::buffer;
+thread_local insert_buffer<kmerAmino_t> graph::buffer_amino;
 
 /**
- * This is vector of hash tables mapping k-mers to colors [O(1)].
+ * This is vector of hash tables mapping k-mers to color classes [O(1)].
  */
-vector<hash_map<kmer_t, color_t>> graph::kmer_table;
+vector<hash_map<kmer_t, uint32_t>> graph::kmer_table;
 
 /**
  * This is the amino equivalent.
  */ 
-vector<hash_map<kmerAmino_t, color_t>> graph::kmer_tableAmino;
+vector<hash_map<kmerAmino_t, uint32_t>> graph::kmer_tableAmino;
+
+/**
+ * These are the distinct color sets of the k-mers (color classes), each stored once.
+ */
+vector<color_t> graph::color_classes;
+
+/**
+ * This is a hash table mapping color sets to their classes [O(1)].
+ */
+hash_map<color_t, uint32_t> graph::color_class_ids;
+
+/**
+ * This is a spinlock protecting the color classes.
+ */
+spinlock graph::color_class_lock;
+
+/**
+ * This is the number of k-mers of each color class.
+ */
+vector<int64_t> graph::class_counts;
+spinlock graph::class_counts_lock;
+
+/**
+ * These are the recent class transitions of the current thread (class + color -> class).
+ */
+thread_local vector<class_transition> graph::transitions;
 
 /**
  * This is a hash table mapping colors to weights [O(1)].
@@ -52,10 +96,20 @@ vector<hash_map<kmerAmino_t, color_t>> graph::kmer_tableAmino;
 hash_map<color_t, array<uint32_t,2>> graph::color_table;
 
 /**
- * This is a hash set used to filter k-mers for coverage (q > 1).
+ * This is an array mapping colors to weights, for few colors.
+ */
+vector<array<uint32_t,2>> graph::dense_color_table;
+
+/**
+ * This is a hash set used to filter k-mers for coverage (q > 1), striped per file slot.
  */
 vector<hash_set<kmer_t>> graph::quality_set;
 
+/**
+ * This is a vector of spinlocks protecting the coverage filter stripes.
+ */
+vector<spinlock> graph::quality_lock;
+
 /**
  * This is a hash map used to filter k-mers for coverage (q > 2).
  */
@@ -67,14 +121,20 @@ vector<hash_map<kmer_t, uint16_t>> graph::quality_map;
 hash_set<kmer_t> graph::blacklist;
 hash_set<kmerAmino_t> graph::blacklist_amino;
 
+/**
+ * These are lock-free hash tables mapping k-mers to colors, used instead of kmer_table if lockfree is set.
+ */
+vector<atomic_table<kmer_t, graph::color_words>> graph::atomic_kmer_table;
+vector<atomic_table<kmerAmino_t, graph::color_words>> graph::atomic_kmer_tableAmino;
+bool graph::lockfree;
+uint64_t graph::kmer_count;
 
 /**
- * This is vector of hash tables mapping k-mers to genomes to buffer a k-mer before adding to the kmer_table. If it is seen a second time, it is added. Otherwise the singleton k-mer is ignored
+ * This is the number of k-mers whose slots in the lock-free hash tables are prefetched ahead of their insertion.
  */
-vector<hash_map<kmer_t, uint16_t>> graph::singleton_kmer_table;
-vector<hash_map<kmerAmino_t, uint16_t>> graph::singleton_kmer_tableAmino;
+uint64_t graph::prefetch = 16;
 uint64_t graph::singleton_counters[maxN];
-spinlock graph::singleton_counters_locks[maxN];
+spinlock graph::singleton_counters_lock;
 
 
 /**
@@ -102,25 +162,13 @@ vector<char> graph::allowedChars;
 /**
  * This function qualifies a k-mer and places it into the hash table.
  */
-function<void(const uint64_t& T, uint_fast32_t& bin, const kmer_t&, const uint16_t&)> graph::emplace_kmer;
-function<void(const uint64_t& T, uint_fast32_t& bin, const kmer_t&, const uint16_t&)> graph::emplace_kmer_tmp;
-function<void(const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t&, const uint16_t&)> graph::emplace_kmer_amino;
-function<void(const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t&, const uint16_t&)> graph::emplace_kmer_amino_tmp;
+void (*graph::emplace_kmer)(const uint64_t& T, uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color);
+void (*graph::emplace_kmer_amino)(const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color);
 
 /**
- * This is a comparison function extending std::bitset.
- */ 
-#if (maxK > 12 || maxN > 64)
-namespace std {
-    template <size_t N>
-    bool operator<(const bitset<N>& x, const bitset<N>& y) {
-        for (uint64_t i = N-1; i != -1; --i) {
-            if (x[i] ^ y[i]) return y[i];
-        }
-        return false;
-    }
-}
-#endif
+ * This function extracts k-mers from a piece of a sequence and adds them to the hash table.
+ */
+void (*graph::add_kmers_path[2])(uint64_t& T, const char* str, const uint64_t& length, kmer_state& state, uint16_t& color);
 
 
 /**
@@ -144,11 +192,16 @@ struct node* newSet(color_t taxa, double weight, vector<node*> subsets) {
  * @param t top list size
  * @param q_table coverage thresholds
  * @param quality global q or maximum among all q values
+ * @param lockfree use the lock-free hash tables
  */
 
-void graph::init(uint64_t& top_size, bool amino, vector<int>& q_table, int& quality, hash_set<kmer_t>& blacklist, hash_set<kmerAmino_t>& blacklist_amino, uint64_t& thread_count) {
+void graph::init(uint64_t& top_size, bool amino, vector<int>& q_table, int& quality, hash_set<kmer_t>& blacklist, hash_set<kmerAmino_t>& blacklist_amino, uint64_t& thread_count, bool lockfree) {
     t = top_size;
     isAmino = amino;
+    graph::lockfree = lockfree;
+    if (0 < color::n && color::n <= dense_colors) {    // few colors, the weights of all color sets fit into an array
+        dense_color_table.assign(1ULL << color::n, {0, 0});
+    }
     if(!isAmino){
 
         // Automatic table count
@@ -158,22 +211,14 @@ void graph::init(uint64_t& top_size, bool amino, vector<int>& q_table, int& qual
         
 
         // Init base tables
-	    kmer_table = vector<hash_map<kmer_t, color_t>> (table_count);
-	    singleton_kmer_table = vector<hash_map<kmer_t, uint16_t>> (table_count);
+        if (lockfree) {
+            atomic_kmer_table = vector<atomic_table<kmer_t, color_words>> (table_count);
+        } else {
+	        kmer_table = vector<hash_map<kmer_t, uint32_t>> (table_count);
+        }
 
         // Init the lock vector
-	    lock = vector<spinlock> (table_count);
-
-        // Precompute the period for fast shift update kmer binning in bitset representation 
-        #if (maxK > 32)     
-        uint_fast32_t last = 1 % table_count;
-        for (int i = 1; i <= 2*(kmer::k); i++)
-        {
-            // cout << last << endl;
-	        period.push_back(last);
-	        last = (2 * last) % table_count;
-        }
-        #endif
+	    lock = vector<padded_spinlock> ((table_count + group_size - 1) / group_size);
 
 	    graph::allowedChars.push_back('A');
         graph::allowedChars.push_back('C');
@@ -186,21 +231,14 @@ void graph::init(uint64_t& top_size, bool amino, vector<int>& q_table, int& qual
         table_count = (0b1u << 14) + 1;
 
         // Init amino tables
-        kmer_tableAmino = vector<hash_map<kmerAmino_t, color_t>> (table_count);
-        singleton_kmer_tableAmino = vector<hash_map<kmerAmino_t, uint16_t>> (table_count);
+        if (lockfree) {
+            atomic_kmer_tableAmino = vector<atomic_table<kmerAmino_t, color_words>> (table_count);
+        } else {
+            kmer_tableAmino = vector<hash_map<kmerAmino_t, uint32_t>> (table_count);
+        }
 		
         // Init the mutex lock vector
-        lock = vector<spinlock> (table_count);
-
-        // Precompute the period for fast shift update kmer binning in bitset representation 
-        #if (maxK > 12)     
-        uint64_t last = 1 % table_count;
-        for (int i = 1; i <= 5*(kmerAmino::k); i++)
-        {
-	        period.push_back(last);
-	        last = (2 * last) % table_count;
-        }
-        #endif
+        lock = vector<padded_spinlock> ((table_count + group_size - 1) / group_size);
 
         graph::allowedChars.push_back('A');
         //graph::allowedChars.push_back('B');
@@ -230,316 +268,633 @@ void graph::init(uint64_t& top_size, bool amino, vector<int>& q_table, int& qual
         //graph::allowedChars.push_back('Z');
         graph::allowedChars.push_back('*');
     }
+    encoder::init(allowedChars, isAmino);    // the binary codes of the allowed characters
+
+    color_classes = {color_t()};    // class 0 is the empty set
+    color_class_ids[color_t()] = 0;
+    for (uint16_t color = 0; color < maxN; ++color) {    // the singleton classes
+        color_t single;
+        single.set(color);
+        color_class_ids[single] = color_classes.size();
+        color_classes.push_back(single);
+    }
 
     graph::quality = quality;
     graph::q_table = q_table;
 	graph::blacklist = blacklist;
 	graph::blacklist_amino = blacklist_amino;
-    switch (quality) {
-    case 1:
-	case 0: /* no quality check */
-        emplace_kmer_tmp = [&] (const uint64_t& T, uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color) {
-            hash_kmer(bin, kmer, color);
-        };
-        emplace_kmer_amino_tmp = [&] (const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color) {
-            hash_kmer_amino(bin, kmer, color);
-        };
-        break;
-
-    case 2:
-        isAmino ? quality_setAmino.resize(thread_count) : quality_set.resize(thread_count);
-        if (q_table.size()>0){
-            emplace_kmer_tmp = [&] (const uint64_t& T, uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color) {
-                if (q_table[color]==1){
-                    hash_kmer(bin, kmer, color);
-                } else if (quality_set[T].find(kmer) == quality_set[T].end()) {
-                    quality_set[T].emplace(kmer);
-                } else {
-                    quality_set[T].erase(kmer);
-                    hash_kmer(bin, kmer, color);
-                }
-            };
-            emplace_kmer_amino_tmp = [&] (const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color) {
-                if (q_table[color]==1){
-                    hash_kmer_amino(bin, kmer, color);
-                } else if (quality_setAmino[T].find(kmer) == quality_setAmino[T].end()) {
-                    quality_setAmino[T].emplace(kmer);
-                } else {
-                    quality_setAmino[T].erase(kmer);
-                    hash_kmer_amino(bin, kmer, color);
-                }
-            };
-        } else { // global quality value (one if-clause fewer)
-            emplace_kmer_tmp = [&] (const uint64_t& T, uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color) {
-                if (quality_set[T].find(kmer) == quality_set[T].end()) {
-                    quality_set[T].emplace(kmer);
-                } else {
-                    quality_set[T].erase(kmer);
-                    hash_kmer(bin, kmer, color);
-                }
-            };
-            emplace_kmer_amino_tmp = [&] (const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color) {
-                if (quality_setAmino[T].find(kmer) == quality_setAmino[T].end()) {
-                    quality_setAmino[T].emplace(kmer);
-                } else {
-                    quality_setAmino[T].erase(kmer);
-                    hash_kmer_amino(bin, kmer, color);
-                }
-            };
-        }
-        break;
-    default:
-        isAmino ? quality_mapAmino.resize(thread_count) : quality_map.resize(thread_count);
-        if (q_table.size()>0){
-            emplace_kmer_tmp = [&] (const uint64_t& T, uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color) {
-                if (quality_map[T][kmer] < q_table[color]-1) {
-                    quality_map[T][kmer]++;
-                } else {
-                    quality_map[T].erase(kmer);
-                    hash_kmer(bin, kmer, color);
-                }
-            };
-            emplace_kmer_amino_tmp = [&] (const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color) {
-                if (quality_mapAmino[T][kmer] < q_table[color]-1) {
-                    quality_mapAmino[T][kmer]++;
-                } else {
-                    quality_mapAmino[T].erase(kmer);
-                    hash_kmer_amino(bin, kmer, color);
-                }
-            };
-        }else { // global quality value
-            emplace_kmer_tmp = [&] (const uint64_t& T, uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color) {
-                if (quality_map[T][kmer] < quality-1) {
-                    quality_map[T][kmer]++;
-                } else {
-                    quality_map[T].erase(kmer);
-                    hash_kmer(bin, kmer, color);
-                }
-            };
-            emplace_kmer_amino_tmp = [&] (const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color) {
-                if (quality_mapAmino[T][kmer] < quality-1) {
-                    quality_mapAmino[T][kmer]++;
-                } else {
-                    quality_mapAmino[T].erase(kmer);
-                    hash_kmer_amino(bin, kmer, color);
-                }
-            };
-
-        }
-        break;
+    if (quality == 2) {
+        isAmino ? quality_setAmino.resize(thread_count * quality_stripes) : quality_set.resize(thread_count * quality_stripes);
+        quality_lock = vector<spinlock> (thread_count * quality_stripes);
+    } else if (quality > 2) {
+        isAmino ? quality_mapAmino.resize(thread_count * quality_stripes) : quality_map.resize(thread_count * quality_stripes);
+        quality_lock = vector<spinlock> (thread_count * quality_stripes);
     }
-	emplace_kmer = [&] (const uint64_t& T, uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color) {
-		emplace_kmer_tmp(T, bin, kmer, color);
-	};
-	emplace_kmer_amino = [&] (const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color) {
-		emplace_kmer_amino_tmp(T, bin, kmer, color);
-	};
+    select_paths();
 }
 
 /**
  * This function activates the use of the blacklist when inserting k-mers. It has to be separated from the init function, because when the latter is called, the blacklist is still empty. 
  */
 void graph::activate_blacklist(){
-    // Black list for kmers given?
-    if ((!isAmino && !blacklist.empty()) || (isAmino && !blacklist_amino.empty())) {
-		emplace_kmer = [&] (const uint64_t& T, uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color) {
-			// only add if kmer not in blacklist
-			if (graph::blacklist.find(kmer)==graph::blacklist.end()) {
-				emplace_kmer_tmp(T, bin, kmer, color);
-			}
-		};
-		emplace_kmer_amino = [&] (const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color) {
-			// only add if kmer not in blacklist
-			if (graph::blacklist_amino.find(kmer)==graph::blacklist_amino.end()) {
-				emplace_kmer_amino_tmp(T, bin, kmer, color);
-			}
-		};
-	}
+    select_paths();
 }
 
-
 /**
-* --- [Hash map access] ---
-* The following methods are used to access the entries of the vectorized hash maps
-*/ 
+ * This function selects the insertion paths for the current coverage filter and blacklist.
+ * The insertion is specialized at compile time, so only this choice is made at runtime.
+ */
+void graph::select_paths() {
+    bool table = q_table.size() > 0;    // coverage threshold per color
+    bool black = isAmino ? !blacklist_amino.empty() : !blacklist.empty();    // black list for k-mers given?
+
+    if (quality <= 1) {    // no quality check
+        black ? select_paths<unfiltered, false, true>() : select_paths<unfiltered, false, false>();
+    } else if (quality == 2) {
+        if (table) black ? select_paths<filter_set, true, true>() : select_paths<filter_set, true, false>();
+        else       black ? select_paths<filter_set, false, true>() : select_paths<filter_set, false, false>();
+    } else {
+        if (table) black ? select_paths<filter_map, true, true>() : select_paths<filter_map, true, false>();
+        else       black ? select_paths<filter_map, false, true>() : select_paths<filter_map, false, false>();
+    }
+}
 
 /**
- * This method shift-updates the bin of a kmer
+ * This function selects the insertion paths for the given coverage filter and blacklist.
  */
+template <graph::filter_mode Q, bool Table, bool Black>
+void graph::select_paths() {
+    emplace_kmer = insert_kmer<Q, Table, Black>;
+    emplace_kmer_amino = insert_kmer_amino<Q, Table, Black>;
+    if (isAmino) {    // amino k-mers have no complements
+        add_kmers_path[0] = add_kmers_path[1] = add_kmers_amino<Q, Table, Black>;
+    } else {
+        add_kmers_path[0] = add_kmers_dna<Q, Table, Black, false>;
+        add_kmers_path[1] = add_kmers_dna<Q, Table, Black, true>;
+    }
+}
 
-uint_fast32_t graph::shift_update_bin(uint_fast32_t& bin, uint_fast8_t& left, uint_fast8_t& right)
-{
-        return (8 * table_count // Bias
-            + 4 * (bin - period[2*kmer::k-1] * (left / 2) - (left % 2) * period[2*kmer::k - 2]) // Shift
-            + period[1] * (right / 2) + period[0] * (right % 2)) // Update   
-            % table_count; // Mod
+/**
+ * This function qualifies a k-mer and places it into the hash table.
+ * With the coverage filter, the occurrences are counted in the cache of the thread first, and are passed
+ * to the (locked) filter when the k-mer is evicted. Once inserted, its repeated occurrences are dropped.
+ *
+ * @tparam Q coverage filter
+ * @tparam Table coverage threshold per color
+ * @tparam Black blacklist in use
+ * @param kmer bit sequence
+ * @param color color flag
+ */
+template <graph::filter_mode Q, bool Table, bool Black>
+void graph::insert_kmer(const uint64_t& T, uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color) {
+    if (Black && blacklist.find(kmer) != blacklist.end()) {
+        return;    // only add if k-mer not in blacklist
+    }
+    if (Q == unfiltered) {
+        buffer_kmer(bin, kmer, color);
+        return;
+    }
+    int q = Table ? q_table[color] : quality;
+    if (buffer.cache.empty()) {    // first k-mer of this thread
+        buffer.cache.resize(cache_size);
+    }
+    auto& cached = buffer.cache[hash<kmer_t>()(kmer) & (cache_size-1)];
+    if (cached.count && cached.kmer == kmer && cached.color == color) {    // a recent k-mer of this thread
+        if (cached.count == inserted || ++cached.count < q) {
+            return;    // inserted already, or still below the coverage threshold
+        }
+        cached.count = inserted;
+        buffer.pending--;
+        buffer_kmer(bin, kmer, color);
+        return;
+    }
+    if (cached.count && cached.count != inserted) {    // pass the occurrences of the evicted k-mer
+        count_kmer(buffer.slot, cached.bin, cached.kmer, cached.count, cached.color);
+        buffer.pending--;
+    }
+    cached = {kmer, (uint32_t) bin, color, 1};
+    if (q <= 1) {
+        cached.count = inserted;
+        buffer_kmer(bin, kmer, color);
+    } else {
+        buffer.pending++;
+        buffer.slot = T;
+    }
 }
 
 /**
- * This method shift updates the reverse complement bin of a kmer
+ * This function passes the occurrences of a cached k-mer to the coverage filter, it is inserted if they are enough.
+ *
+ * @param T file slot
+ * @param bin index of the target hash map
+ * @param kmer bit sequence
+ * @param count number of occurrences
+ * @param color color flag
  */
-uint_fast32_t graph::shift_update_rc_bin(uint_fast32_t& rc_bin, uint_fast8_t& left, uint_fast8_t& right)
-{   
-    // Remove
-    rc_bin += 8 * table_count - period[1] * (!(left / 2 )) - period[0] * (!(left % 2 ));
-    // First shift
-    if (rc_bin & 0b1u) {rc_bin += table_count;}
-    rc_bin >>= 1;
-    // Second shift
-    if (rc_bin & 0b1u) {rc_bin += table_count;}
-    rc_bin >>= 1;
-    // Update
-    rc_bin += (period[2*kmer::k-1] * (!(right / 2)) + period[2*kmer::k-2] * (!(right % 2)));
-    rc_bin %= table_count;
-    return rc_bin;
+void graph::count_kmer(const uint64_t& T, uint_fast32_t bin, const kmer_t& kmer, const uint16_t& count, const uint16_t& color) {
+    uint64_t stripe = T * quality_stripes + bin % quality_stripes;
+    bool seen;
+    quality_lock[stripe].lock();
+    if (quality == 2) {    // at most one occurrence is passed, the other one would have inserted the k-mer
+        seen = quality_set[stripe].erase(kmer) > 0;
+        if (!seen) {
+            quality_set[stripe].emplace(kmer);
+        }
+    } else {
+        uint16_t& total = quality_map[stripe][kmer];
+        seen = total + count >= (q_table.size() > 0 ? q_table[color] : quality);
+        if (seen) {
+            quality_map[stripe].erase(kmer);
+        } else {
+            total += count;
+        }
+    }
+    quality_lock[stripe].unlock();
+    if (seen) buffer_kmer(bin, kmer, color);
 }
 
+/**
+ * This function qualifies an amino k-mer and places it into the hash table.
+ * With the coverage filter, the occurrences are counted in the cache of the thread first, and are passed
+ * to the (locked) filter when the k-mer is evicted. Once inserted, its repeated occurrences are dropped.
+ *
+ * @tparam Q coverage filter
+ * @tparam Table coverage threshold per color
+ * @tparam Black blacklist in use
+ * @param kmer bit sequence
+ * @param color color flag
+ */
+template <graph::filter_mode Q, bool Table, bool Black>
+void graph::insert_kmer_amino(const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color) {
+    if (Black && blacklist_amino.find(kmer) != blacklist_amino.end()) {
+        return;    // only add if k-mer not in blacklist
+    }
+    if (Q == unfiltered) {
+        buffer_kmer_amino(bin, kmer, color);
+        return;
+    }
+    int q = Table ? q_table[color] : quality;
+    if (buffer_amino.cache.empty()) {    // first k-mer of this thread
+        buffer_amino.cache.resize(cache_size);
+    }
+    auto& cached = buffer_amino.cache[hash<kmerAmino_t>()(kmer) & (cache_size-1)];
+    if (cached.count && cached.kmer == kmer && cached.color == color) {    // a recent k-mer of this thread
+        if (cached.count == inserted || ++cached.count < q) {
+            return;    // inserted already, or still below the coverage threshold
+        }
+        cached.count = inserted;
+        buffer_amino.pending--;
+        buffer_kmer_amino(bin, kmer, color);
+        return;
+    }
+    if (cached.count && cached.count != inserted) {    // pass the occurrences of the evicted k-mer
+        count_kmer_amino(buffer_amino.slot, cached.bin, cached.kmer, cached.count, cached.color);
+        buffer_amino.pending--;
+    }
+    cached = {kmer, (uint32_t) bin, color, 1};
+    if (q <= 1) {
+        cached.count = inserted;
+        buffer_kmer_amino(bin, kmer, color);
+    } else {
+        buffer_amino.pending++;
+        buffer_amino.slot = T;
+    }
+}
 
 /**
- * This method shift-updates the bin of an amino kmer
+ * This function passes the occurrences of a cached amino k-mer to the coverage filter, it is inserted if they are enough.
+ *
+ * @param T file slot
+ * @param bin index of the target hash map
+ * @param kmer bit sequence
+ * @param count number of occurrences
+ * @param color color flag
  */
-uint_fast32_t graph::shift_update_amino_bin(uint_fast32_t& bin, kmerAmino_t& kmer, uint_fast8_t& right)
-{
-    // update the binning carry (solution of the shift-update-carry equation)
-    // shift
-    bin = 160 * table_count + // Bias 
-                32 * (bin // Shift
-                - kmer.test(5*kmerAmino::k - 1) * period[5*kmerAmino::k - 1]
-                - kmer.test(5*kmerAmino::k - 2) * period[5*kmerAmino::k - 2]
-                - kmer.test(5*kmerAmino::k - 3) * period[5*kmerAmino::k - 3]
-                - kmer.test(5*kmerAmino::k - 4) * period[5*kmerAmino::k - 4]
-                - kmer.test(5*kmerAmino::k - 5) * period[5*kmerAmino::k - 5]);
-    // update
-    for(int i = 4; i>=0; i--){
-        bin += period[i] * ((right >> i) & 0b1u);
-    }
-    // mod
-    bin %= table_count;
-    return bin;
-}
-
-/**
- * This method computes the bin of a given kmer(slower than shift update)
+void graph::count_kmer_amino(const uint64_t& T, uint_fast32_t bin, const kmerAmino_t& kmer, const uint16_t& count, const uint16_t& color) {
+    uint64_t stripe = T * quality_stripes + bin % quality_stripes;
+    bool seen;
+    quality_lock[stripe].lock();
+    if (quality == 2) {    // at most one occurrence is passed, the other one would have inserted the k-mer
+        seen = quality_setAmino[stripe].erase(kmer) > 0;
+        if (!seen) {
+            quality_setAmino[stripe].emplace(kmer);
+        }
+    } else {
+        uint16_t& total = quality_mapAmino[stripe][kmer];
+        seen = total + count >= (q_table.size() > 0 ? q_table[color] : quality);
+        if (seen) {
+            quality_mapAmino[stripe].erase(kmer);
+        } else {
+            total += count;
+        }
+    }
+    quality_lock[stripe].unlock();
+    if (seen) buffer_kmer_amino(bin, kmer, color);
+}
+
+
+/**
+* --- [Hash map access] ---
+* The following methods are used to access the entries of the vectorized hash maps
+*/ 
+
+/**
+ * This method computes the bin of a given kmer from the high bits of its hash value
+ * (the hash tables use the low bits).
  * @param kmer The target kmer
  * @return uint64_t The bin
  */
-#if (maxK <= 32)
 uint_fast32_t graph::compute_bin(const kmer_t& kmer)
 {
-    return kmer % table_count;
+    return hasher::shard(hash<kmer_t>()(kmer), table_count);
 }
-#else
-uint_fast32_t graph::compute_bin(const kmer_t& kmer)
+
+/**
+ * This method computes the bin of a given amino kmer from the high bits of its hash value
+ * @param kmer The target kmer
+ * @return uint64_t The bin
+ */
+uint_fast32_t graph::compute_amino_bin(const kmerAmino_t& kmer)
 {
-	uint_fast32_t carry = 1;
-	uint_fast32_t rest = 0;
-	if (kmer.test(0)){rest++;} // Test the last bit
-	for (uint_fast32_t it=1; it < 2 * kmer::k; it++){
-	    carry = (2*carry) % table_count;
-	    if (kmer.test(it)){rest += carry;}
-	}
-	return rest % table_count;
+    return hasher::shard(hash<kmerAmino_t>()(kmer), table_count);
 }
-#endif
 
-#if maxK <= 12
-    uint_fast32_t graph::compute_amino_bin(const kmerAmino_t& kmer)
-    {
-        return kmer % table_count;
-    }
-#else
-    uint_fast32_t graph::compute_amino_bin(const kmerAmino_t& kmer)
-    {
-	    uint_fast32_t carry = 1;
-	    uint_fast32_t rest = 0;
 
-	    if (kmer.test(0)){rest++;} // Test the last bit
-	    for (uint_fast32_t it=1; it < 5* kmerAmino::k; it--){
-	        carry = (2*carry) % table_count;
-	        if (kmer.test(it)){rest += carry;}
-	    }
-	    return rest % table_count;
+/**
+* This function hashes a k-mer and stores it in the correstponding hash table.
+* The corresponding table is chosen by the high bits of the hash value of the k-mer.
+*  @param kmer The kmer to store
+*  @param color The color to store 
+*/
+void graph::hash_kmer(uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color)
+{
+    if (lockfree) {
+        atomic_kmer_table[bin].insert(kmer, color);
+        return;
     }
-#endif
+    lock[bin / group_size].lock();
+    store_kmer(bin, kmer, color);
+    lock[bin / group_size].unlock();
+}
 
 
 /**
-* This function hashes a k-mer and stores it in the correstponding hash table.
-* The corresponding table is chosen by the carry of the encoded k-mer given the number of tables as module.
+ * This function hashes an amino k-mer and stores it in the corresponding hash table.
+ * The corresponding table is chosen by the high bits of the hash value of the k-mer.
+ * @param kmer The kmer to store
+ * @param color The color to store
+ */
+void graph::hash_kmer_amino(uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color)
+{
+    if (lockfree) {
+        atomic_kmer_tableAmino[bin].insert(kmer, color);
+        return;
+    }
+    lock[bin / group_size].lock();
+    store_kmer_amino(bin, kmer, color);
+    lock[bin / group_size].unlock();
+}
+
+/**
+* This function stores a k-mer in its hash table, the lock of its group has to be held.
+* The singleton counts are changed in the buffer of the current thread (see flush).
 *  @param kmer The kmer to store
 *  @param color The color to store 
 */
-void graph::hash_kmer(uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color)
+void graph::store_kmer(const uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color)
 {
-    lock[bin].lock();
-	hash_map<kmer_t,color_t>::iterator entry=kmer_table[bin].find(kmer); 
-	// already in the kmer table? -> add
+	hash_map<kmer_t,uint32_t>::iterator entry=kmer_table[bin].find(kmer); 
+	// already in the kmer table? -> add (a singleton k-mer is promoted in place)
 	if(entry != kmer_table[bin].end()){
-		entry.value().set(color);
+		uint32_t id = add_color(entry.value(), color);
+		if(id != entry.value()){
+			if(is_singleton_class(entry.value())) {buffer.singletons[entry.value()-1]--; buffer.kmers++;}
+			else {count_class(buffer, entry.value(), -1);}
+			count_class(buffer, id, 1);
+		}
+		entry.value() = id;
 	}
-	// not yet in the kmer table?
+	// not seen before -> add as a singleton k-mer
 	else{
-		hash_map<kmer_t,uint16_t>::iterator s_entry = singleton_kmer_table[bin].find(kmer);
- 		//seen once before? -> add to kmer table / remove from singleton table
-		if(s_entry != singleton_kmer_table[bin].end()){
-			if(s_entry.value() != color){
-				kmer_table[bin][kmer].set(s_entry.value());
-				kmer_table[bin][kmer].set(color);
-				singleton_counters_locks[s_entry.value()].lock();
-				singleton_counters[s_entry.value()]--;
-				singleton_counters_locks[s_entry.value()].unlock();
-				singleton_kmer_table[bin].erase(s_entry);
-			}
-		}
-		// not seen before -> add to singleton_table
-		else{
-			singleton_kmer_table[bin][kmer]=color;
-			singleton_counters_locks[color].lock();
-			singleton_counters[color]++;
-			singleton_counters_locks[color].unlock();
-		}
+		kmer_table[bin].insert({kmer, singleton_class(color)});
+		buffer.singletons[color]++;
 	}
-    lock[bin].unlock();
 }
 
 
 /**
- * This function hashes an amino k-mer and stores it in the corresponding hash table.
- * The correspontind table is chosen by the carry of the encoded k-mer bitset by the bit-module function.
+ * This function stores an amino k-mer in its hash table, the lock of its group has to be held.
+ * The singleton counts are changed in the buffer of the current thread (see flush).
  * @param kmer The kmer to store
  * @param color The color to store
  */
-void graph::hash_kmer_amino(uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color)
+void graph::store_kmer_amino(const uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color)
 {
-    lock[bin].lock();
-	hash_map<kmerAmino_t,color_t>::iterator entry=kmer_tableAmino[bin].find(kmer); 
-	// already in the kmer table? -> add
+	hash_map<kmerAmino_t,uint32_t>::iterator entry=kmer_tableAmino[bin].find(kmer); 
+	// already in the kmer table? -> add (a singleton k-mer is promoted in place)
 	if(entry != kmer_tableAmino[bin].end()){
-		entry.value().set(color);
+		uint32_t id = add_color(entry.value(), color);
+		if(id != entry.value()){
+			if(is_singleton_class(entry.value())) {buffer_amino.singletons[entry.value()-1]--; buffer_amino.kmers++;}
+			else {count_class(buffer_amino, entry.value(), -1);}
+			count_class(buffer_amino, id, 1);
+		}
+		entry.value() = id;
 	}
-	// not yet in the kmer table?
+	// not seen before -> add as a singleton k-mer
 	else{
-		hash_map<kmerAmino_t,uint16_t>::iterator s_entry = singleton_kmer_tableAmino[bin].find(kmer);
- 		//seen once before? -> add to kmer table / remove from singleton table
-		if(s_entry != singleton_kmer_tableAmino[bin].end()){
-			if(s_entry.value() != color){
-				kmer_tableAmino[bin][kmer].set(s_entry.value());
-				kmer_tableAmino[bin][kmer].set(color);
-				singleton_counters_locks[s_entry.value()].lock();
-				singleton_counters[s_entry.value()]--;
-				singleton_counters_locks[s_entry.value()].unlock();
-				singleton_kmer_tableAmino[bin].erase(s_entry);
-			}
-		}
-		// not seen before -> add to singleton_table
-		else{
-			singleton_kmer_tableAmino[bin][kmer]=color;
-			singleton_counters_locks[color].lock();
-			singleton_counters[color]++;
-			singleton_counters_locks[color].unlock();
-		}
-	}	
-    lock[bin].unlock();
+		kmer_tableAmino[bin].insert({kmer, singleton_class(color)});
+		buffer_amino.singletons[color]++;
+	}
+}
+
+/**
+ * This function changes the k-mer count of a color class, collected in the buffer of the current thread.
+ * A change that is replaced in the direct-mapped cache is kept until enough of them are added at once.
+ *
+ * @param buffer buffer of the current thread
+ * @param id color class
+ * @param change change of the count
+ */
+template <typename K>
+void graph::count_class(insert_buffer<K>& buffer, const uint32_t& id, const int64_t& change)
+{
+    if (buffer.classes.empty()) {    // first change of this thread
+        buffer.classes.assign(class_cache_size, {0, 0});
+    }
+    class_delta& entry = buffer.classes[id & (class_cache_size-1)];
+    if (entry.id != id) {
+        if (entry.count != 0) {
+            buffer.evicted.push_back(entry);
+            if (buffer.evicted.size() >= class_flush_size) add_class_counts(buffer.evicted);
+        }
+        entry = {id, 0};
+    }
+    entry.count += change;
+}
+
+/**
+ * This function adds changes to the class counts.
+ *
+ * @param deltas changes of the class counts, cleared afterwards
+ */
+void graph::add_class_counts(vector<class_delta>& deltas)
+{
+    class_counts_lock.lock();
+    for (auto& delta : deltas) {
+        if (delta.id >= class_counts.size()) class_counts.resize(delta.id + 1);
+        class_counts[delta.id] += delta.count;
+    }
+    class_counts_lock.unlock();
+    deltas.clear();
+}
+
+/**
+ * This function returns the class of a color set with a color added.
+ * The transitions are memoized per thread, only new ones look up the color set under the lock.
+ *
+ * @param id color class
+ * @param color color to add
+ * @return color class
+ */
+uint32_t graph::add_color(const uint32_t& id, const uint16_t& color)
+{
+    if (transitions.empty()) {    // first transition of this thread
+        transitions.assign(transition_cache_size, {UINT32_MAX, 0, 0});
+    }
+    class_transition& memo = transitions[hasher::mix((uint64_t) id << 16 | color) & (transition_cache_size-1)];
+    if (memo.from == id && memo.color == color) return memo.to;
+
+    color_class_lock.lock();
+    color_t colors = color_classes[id];
+    colors.set(color);
+    auto entry = color_class_ids.find(colors);
+    uint32_t to;
+    if (entry != color_class_ids.end()) {
+        to = entry->second;
+    } else {    // new color class
+        to = color_classes.size();
+        color_classes.push_back(colors);
+        color_class_ids[colors] = to;
+    }
+    color_class_lock.unlock();
+    memo = {id, to, color};
+    return to;
+}
+
+/**
+ * This function buffers a k-mer of the current thread, the group of its hash table is flushed when full.
+ * @param kmer The kmer to store
+ * @param color The color to store
+ */
+void graph::buffer_kmer(uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color)
+{
+    if (lockfree) {    // no need to buffer by group, but the slots are prefetched a few k-mers ahead
+        if (prefetch == 0) {
+            atomic_kmer_table[bin].insert(kmer, color);
+            return;
+        }
+        uint64_t hash = std::hash<kmer_t>()(kmer);
+        atomic_kmer_table[bin].prefetch(hash);
+        if (buffer.ahead.size() < prefetch) {    // fill the ring first
+            buffer.ahead.push_back({kmer, hash, (uint32_t) bin, color});
+            return;
+        }
+        auto& oldest = buffer.ahead[buffer.ahead_pos];
+        atomic_kmer_table[oldest.bin].insert(oldest.kmer, oldest.hash, oldest.color);
+        oldest = {kmer, hash, (uint32_t) bin, color};
+        buffer.ahead_pos = (buffer.ahead_pos + 1) % prefetch;
+        return;
+    }
+    if (buffer.fill.empty()) {    // first k-mer of this thread
+        buffer.fill.resize(lock.size());
+        buffer.entries.resize(lock.size() * buffer_size);
+    }
+    uint64_t group = bin / group_size;
+    buffer.entries[group * buffer_size + buffer.fill[group]++] = {kmer, (uint32_t) bin, color};
+    if (buffer.fill[group] == buffer_size) flush_group(group);
+}
+
+/**
+ * This function buffers an amino k-mer of the current thread, the group of its hash table is flushed when full.
+ * @param kmer The kmer to store
+ * @param color The color to store
+ */
+void graph::buffer_kmer_amino(uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color)
+{
+    if (lockfree) {    // no need to buffer by group, but the slots are prefetched a few k-mers ahead
+        if (prefetch == 0) {
+            atomic_kmer_tableAmino[bin].insert(kmer, color);
+            return;
+        }
+        uint64_t hash = std::hash<kmerAmino_t>()(kmer);
+        atomic_kmer_tableAmino[bin].prefetch(hash);
+        if (buffer_amino.ahead.size() < prefetch) {    // fill the ring first
+            buffer_amino.ahead.push_back({kmer, hash, (uint32_t) bin, color});
+            return;
+        }
+        auto& oldest = buffer_amino.ahead[buffer_amino.ahead_pos];
+        atomic_kmer_tableAmino[oldest.bin].insert(oldest.kmer, oldest.hash, oldest.color);
+        oldest = {kmer, hash, (uint32_t) bin, color};
+        buffer_amino.ahead_pos = (buffer_amino.ahead_pos + 1) % prefetch;
+        return;
+    }
+    if (buffer_amino.fill.empty()) {    // first k-mer of this thread
+        buffer_amino.fill.resize(lock.size());
+        buffer_amino.entries.resize(lock.size() * buffer_size);
+    }
+    uint64_t group = bin / group_size;
+    buffer_amino.entries[group * buffer_size + buffer_amino.fill[group]++] = {kmer, (uint32_t) bin, color};
+    if (buffer_amino.fill[group] == buffer_size) flush_group_amino(group);
+}
+
+/**
+ * This function stores the buffered k-mers of a group under a single lock acquisition.
+ * @param group index of the group
+ */
+void graph::flush_group(const uint64_t& group)
+{
+    auto entry = buffer.entries.begin() + group * buffer_size;
+    lock[group].lock();
+    for (auto end = entry + buffer.fill[group]; entry != end; ++entry) {
+        store_kmer(entry->bin, entry->kmer, entry->color);
+    }
+    lock[group].unlock();
+    buffer.fill[group] = 0;
+}
+
+/**
+ * This function stores the buffered amino k-mers of a group under a single lock acquisition.
+ * @param group index of the group
+ */
+void graph::flush_group_amino(const uint64_t& group)
+{
+    auto entry = buffer_amino.entries.begin() + group * buffer_size;
+    lock[group].lock();
+    for (auto end = entry + buffer_amino.fill[group]; entry != end; ++entry) {
+        store_kmer_amino(entry->bin, entry->kmer, entry->color);
+    }
+    lock[group].unlock();
+    buffer_amino.fill[group] = 0;
+}
+
+/**
+ * This function stores the buffered k-mers of the current thread and adds its k-mer, singleton, and class counts.
+ * Each thread that added k-mers has to call it before the hash tables are used.
+ */
+void graph::flush()
+{
+    for (auto& entry : buffer.ahead) {    // the prefetched k-mers (in any order)
+        atomic_kmer_table[entry.bin].insert(entry.kmer, entry.hash, entry.color);
+    }
+    for (auto& entry : buffer_amino.ahead) {
+        atomic_kmer_tableAmino[entry.bin].insert(entry.kmer, entry.hash, entry.color);
+    }
+    buffer.ahead.clear(); buffer.ahead_pos = 0;
+    buffer_amino.ahead.clear(); buffer_amino.ahead_pos = 0;
+    for (uint64_t group = 0; group < buffer.fill.size(); ++group) {
+        if (buffer.fill[group] > 0) flush_group(group);
+    }
+    for (uint64_t group = 0; group < buffer_amino.fill.size(); ++group) {
+        if (buffer_amino.fill[group] > 0) flush_group_amino(group);
+    }
+    for (auto& entry : buffer.classes) {    // the class counts
+        if (entry.count != 0) {buffer.evicted.push_back(entry); entry.count = 0;}
+    }
+    for (auto& entry : buffer_amino.classes) {
+        if (entry.count != 0) {buffer_amino.evicted.push_back(entry); entry.count = 0;}
+    }
+    add_class_counts(buffer.evicted);
+    add_class_counts(buffer_amino.evicted);
+    singleton_counters_lock.lock();
+    for (uint64_t color = 0; color < maxN; ++color) {
+        singleton_counters[color] += buffer.singletons[color] + buffer_amino.singletons[color];
+        buffer.singletons[color] = 0;
+        buffer_amino.singletons[color] = 0;
+    }
+    kmer_count += buffer.kmers + buffer_amino.kmers;
+    buffer.kmers = 0; buffer_amino.kmers = 0;
+    singleton_counters_lock.unlock();
+}
+
+/**
+ * This function passes the cached occurrences of the current thread to the coverage filter.
+ * The cached occurrences belong to one file slot, so each thread has to call it before it hashes a batch
+ * of another file, and before the coverage filter of the file is cleared.
+ */
+void graph::flush_cache()
+{
+    for (auto& cached : buffer.cache) {
+        if (buffer.pending == 0) break;
+        if (cached.count && cached.count != inserted) {
+            count_kmer(buffer.slot, cached.bin, cached.kmer, cached.count, cached.color);
+            cached.count = 0;
+            buffer.pending--;
+        }
+    }
+    for (auto& cached : buffer_amino.cache) {
+        if (buffer_amino.pending == 0) break;
+        if (cached.count && cached.count != inserted) {
+            count_kmer_amino(buffer_amino.slot, cached.bin, cached.kmer, cached.count, cached.color);
+            cached.count = 0;
+            buffer_amino.pending--;
+        }
+    }
+}
+
+/**
+ * This function merges the lock-free hash tables and counts their singleton k-mers, after all k-mers are inserted.
+ *
+ * @param thread_count the number of threads used for processing
+ */
+void graph::compact(uint64_t& thread_count)
+{
+    if (!lockfree) return;
+    atomic<uint64_t> index(0);    // the next table to merge
+    atomic<uint64_t> count(0);    // the number of non-singleton k-mers
+    auto lambda = [&] () {
+        uint64_t multiple = 0;
+        auto check = [&] (const uint64_t* words) {
+            uint64_t colors = 0, color = 0;
+            for (uint64_t w = 0; w < color_words; ++w) {
+                colors += __builtin_popcountll(words[w]);
+                if (words[w]) color = 64 * w + __builtin_ctzll(words[w]);
+            }
+            colors == 1 ? buffer.singletons[color]++ : multiple++;
+        };
+        for (uint64_t i = index++; i < table_count; i = index++) {
+            if (isAmino) {
+                atomic_kmer_tableAmino[i].merge();
+                atomic_kmer_tableAmino[i].for_each([&] (const kmerAmino_t& kmer, const uint64_t* words) {check(words);});
+            } else {
+                atomic_kmer_table[i].merge();
+                atomic_kmer_table[i].for_each([&] (const kmer_t& kmer, const uint64_t* words) {check(words);});
+            }
+        }
+        count += multiple;
+        flush();    // add the singleton counts
+    };
+    vector<thread> thread_holder;
+    for (uint64_t thread_id = 0; thread_id < thread_count; ++thread_id) {thread_holder.emplace_back(lambda);}
+    for (auto& thread : thread_holder) {thread.join();}
+    kmer_count = count;
+}
+
+/**
+ * This function converts the color words of a lock-free hash table entry.
+ *
+ * @param words color words
+ * @return color set
+ */
+color_t graph::to_color(const uint64_t* words)
+{
+    color_t color = 0b0u;
+    for (uint64_t w = 0; w < color_words; ++w) {
+        for (uint64_t word = words[w]; word; word &= word-1) {
+            color.set(64 * w + __builtin_ctzll(word));
+        }
+    }
+    return color;
 }
 
 /**
@@ -568,7 +923,7 @@ bool graph::search_kmer_amino(const kmerAmino_t& kmer)
 * @return color_t The stored colores
 */
 color_t graph::get_color(const kmer_t& kmer, bool reversed){
-    return kmer_table[compute_bin(kmer)][kmer];
+    return color_classes[kmer_table[compute_bin(kmer)][kmer]];
 }
 
 
@@ -578,7 +933,7 @@ color_t graph::get_color(const kmer_t& kmer, bool reversed){
  * return color_t The stored color vector
  */
 color_t graph::get_color_amino(const kmerAmino_t& kmer){
-    return kmer_tableAmino[compute_amino_bin(kmer)][kmer];
+    return color_classes[kmer_tableAmino[compute_amino_bin(kmer)][kmer]];
 }
 
 /**
@@ -639,22 +994,13 @@ void graph::fill_blacklist(string& str, bool& reverse) {
         if (!isAmino) {
 
             right = util::char_to_bits(str[pos]);
-            #if maxK <= 32
-                kmer::shift(kmer, right); // shift each base into the bit sequence
-                rcmer = kmer;
-	            if (reverse){
-                    kmer::reverse_complement(rcmer); // invert the k-mer
-                }
-            #else
-                kmer::shift(kmer, right); // shift each base into the bit sequence
-                rcmer = kmer;
-                if (reverse){
-                    kmer::reverse_complement(rcmer);
-                }
-            #endif
+            kmer::shift(kmer, right); // shift each base into the bit sequence
+            if (reverse){
+                kmer::shift_reverse(rcmer, right); // roll the inverted k-mer
+            }
              // If the current word is a k-mer
             if (pos+1 - begin >= kmer::k) {
-                rcmer < kmer ? blacklist.emplace(rcmer) : blacklist.emplace(kmer);
+                reverse && rcmer < kmer ? blacklist.emplace(rcmer) : blacklist.emplace(kmer);
             }
         
         // Amino processing
@@ -692,85 +1038,133 @@ uint64_t graph::size_blacklist(){
 void graph::add_kmers(uint64_t& T, string& str, uint16_t& color, bool& reverse) {
     if (str.length() < kmer::k) return;    // not enough characters
 
-    uint_fast32_t bin = 0; // current hash_map vector index
-    uint_fast32_t rc_bin = 0; // current reverse hash_map vector index
+    kmer_state state;    // start a new sequence
+    reset(state);
+    add_kmers(T, str.data(), str.length(), state, color, reverse);
+}
 
-    uint64_t pos;    // current position in the string, from 0 to length
+/**
+ * This function resets a rolling k-mer state at the beginning of a new sequence.
+ *
+ * @param state rolling k-mer state
+ */
+void graph::reset(kmer_state& state) {
+    state.kmer = 0b0u;
+    state.rcmer = 0b0u;
+    state.kmerAmino = 0b0u;
+    state.length = 0;
+}
 
-    kmer_t kmer;    // create a new empty bit sequence for the k-mer
-    kmer_t rcmer; // create a bit sequence for the reverse complement
+/**
+ * This function extracts k-mers from a piece of a sequence and adds them to the hash table.
+ * The k-mer state is carried over from the previous piece, so a sequence can be passed line by line.
+ *
+ * @param str first character of the piece (upper or lower case)
+ * @param length number of characters
+ * @param state rolling k-mer state of the sequence
+ * @param color color flag
+ * @param reverse merge complements
+ */
+void graph::add_kmers(uint64_t& T, const char* str, const uint64_t& length, kmer_state& state, uint16_t& color, bool& reverse) {
+    add_kmers_path[reverse](T, str, length, state, color);    // the loop specialized for the current settings
+}
 
+/**
+ * This function extracts DNA k-mers from a piece of a sequence and adds them to the hash table.
+ *
+ * @tparam Q coverage filter
+ * @tparam Table coverage threshold per color
+ * @tparam Black blacklist in use
+ * @tparam Reverse merge complements
+ * @param str first character of the piece (upper or lower case)
+ * @param length number of characters
+ * @param state rolling k-mer state of the sequence
+ * @param color color flag
+ */
+template <graph::filter_mode Q, bool Table, bool Black, bool Reverse>
+void graph::add_kmers_dna(uint64_t& T, const char* str, const uint64_t& length, kmer_state& state, uint16_t& color) {
+
+    kmer_t& kmer = state.kmer;    // the bit sequence of the current k-mer
+    kmer_t& rcmer = state.rcmer; // the bit sequence of the reverse complement
+    uint_fast32_t bin; // hash_map vector index of the canonical k-mer
 
-    uint_fast8_t left;  // The character that is shifted out 
     uint_fast8_t right; // The binary code of the character that is shifted in
 
-    #if maxK > 32
-    if (!isAmino){
-        for (int i =0; i < 2* kmer::k; i++){rc_bin += period[i];}
-        rc_bin %= table_count;
-    }
-    #endif
+    uint8_t codes[1024];    // binary codes of a block of the piece
+    uint64_t invalid[1024/64];    // invalid positions of the block
 
-    kmerAmino_t kmerAmino=0;    // create a new empty bit sequence for the k-mer
-
-    uint64_t begin = 0;
-    
-    next_kmer:
+    for (uint64_t begin = 0; begin < length; begin += 1024) {    // encode the piece block-wise
+        uint64_t size = min<uint64_t>(1024, length - begin);
+        encoder::encode(str + begin, size, codes, invalid);
 
-    pos = begin;
-    for (; pos < str.length(); ++pos) {    // collect the bases from the string
-        if (!isAllowedChar(pos, str)) {
-            begin = pos+1;    // str = str.substr(pos+1, string::npos);
-            goto next_kmer;    // unknown base, start a new k-mer from the beginning
-        }
-        // DNA processing 
-        if (!isAmino) {
-            right = util::char_to_bits(str[pos]);
-            #if maxK <= 32
+        for (uint64_t pos = 0; pos < size; ) {
+            uint64_t end = encoder::next(invalid, pos, size, true);    // the valid characters up to the next invalid one
+            for (; pos < end; ++pos) {    // collect the bases from the string
+                state.length++;
+                right = codes[pos];
                 kmer::shift(kmer, right); // shift each base into the bit sequence
-                rcmer = kmer;
-
-                bin = kmer % table_count; // update the forward bin
-	            if (reverse){
-                    kmer::reverse_complement(rcmer); // invert the k-mer
-                    rc_bin = rcmer % table_count;
+                if (Reverse){
+                    kmer::shift_reverse(rcmer, right); // roll the inverted k-mer
                 }
-            #else
-                left = 2*kmer.test(2*kmer::k-1)+kmer.test(2*kmer::k-2); // old leftmost character
-                bin = shift_update_bin(bin, left, right); // Shift update the forward complement bin
-                
-                kmer::shift(kmer, right); // shift each base into the bit sequence
-                rcmer = kmer;
-                if (reverse){
-                    kmer::reverse_complement(rcmer);
-                    rc_bin = shift_update_rc_bin(rc_bin, left, right);  // Update the reverse complement table index
+                 // If the current word is a k-mer
+                if (state.length >= kmer::k) {
+                    const kmer_t& canonical = Reverse && rcmer < kmer ? rcmer : kmer;
+                    bin = compute_bin(canonical); // the bin of the inserted k-mer only
+                    insert_kmer<Q, Table, Black>(T, bin, canonical, color);
                 }
-            #endif
-             // If the current word is a k-mer
-            if (pos+1 - begin >= kmer::k) {
-                rcmer < kmer ? emplace_kmer(T, rc_bin, rcmer, color) : emplace_kmer(T, bin, kmer, color);
             }
-        
-        // Amino processing
-        } else {
-            right = util::amino_char_to_bits(str[pos]);
-            #if maxK <= 12
-                kmerAmino::shift_right(kmerAmino, str[pos]);    // shift each base into the bit sequence
-                bin = kmerAmino % table_count;
-            #else
-                bin = shift_update_amino_bin(bin, kmerAmino, right);
-                kmerAmino::shift_right(kmerAmino, str[pos]);
-            #endif
-            // The current word is a k-mer
-            if (pos+1 - begin >= kmerAmino::k) {
-                // shift update the bin
-                // Insert the k-mer into its table
-                emplace_kmer_amino(T, bin, kmerAmino, color);  // update the k-mer with the current color
+            if (pos < size) {    // unknown bases, start a new k-mer from the beginning
+                state.length = 0;
+                pos = encoder::next(invalid, pos, size, false);
             }
         }
     }
-    
+}
 
+/**
+ * This function extracts amino k-mers from a piece of a sequence and adds them to the hash table.
+ *
+ * @tparam Q coverage filter
+ * @tparam Table coverage threshold per color
+ * @tparam Black blacklist in use
+ * @param str first character of the piece (upper or lower case)
+ * @param length number of characters
+ * @param state rolling k-mer state of the sequence
+ * @param color color flag
+ */
+template <graph::filter_mode Q, bool Table, bool Black>
+void graph::add_kmers_amino(uint64_t& T, const char* str, const uint64_t& length, kmer_state& state, uint16_t& color) {
+
+    kmerAmino_t& kmerAmino = state.kmerAmino;    // the bit sequence of the current amino k-mer
+    uint_fast32_t bin; // hash_map vector index of the current k-mer
+
+    uint_fast8_t right; // The binary code of the character that is shifted in
+
+    uint8_t codes[1024];    // binary codes of a block of the piece
+    uint64_t invalid[1024/64];    // invalid positions of the block
+
+    for (uint64_t begin = 0; begin < length; begin += 1024) {    // encode the piece block-wise
+        uint64_t size = min<uint64_t>(1024, length - begin);
+        encoder::encode(str + begin, size, codes, invalid);
+
+        for (uint64_t pos = 0; pos < size; ) {
+            uint64_t end = encoder::next(invalid, pos, size, true);    // the valid characters up to the next invalid one
+            for (; pos < end; ++pos) {    // collect the amino acids from the string
+                state.length++;
+                right = codes[pos];
+                kmerAmino::shift_right(kmerAmino, right);    // shift each base into the bit sequence
+                // The current word is a k-mer
+                if (state.length >= kmerAmino::k) {
+                    bin = compute_amino_bin(kmerAmino);
+                    insert_kmer_amino<Q, Table, Black>(T, bin, kmerAmino, color);  // update the k-mer with the current color
+                }
+            }
+            if (pos < size) {    // unknown characters, start a new k-mer from the beginning
+                state.length = 0;
+                pos = encoder::next(invalid, pos, size, false);
+            }
+        }
+    }
 }
 
 /**
@@ -813,20 +1207,19 @@ next_kmer:
             goto next_kmer;    // unknown base, start a new k-mer from the beginning
         }
         if (!isAmino) {
-            kmer::shift(kmer, str[pos]);    // shift each base into the bit sequence
+            uint_fast8_t right = encoder::code(str[pos]);
+            kmer::shift(kmer, right);    // shift each base into the bit sequence
+            if (reverse) {kmer::shift_reverse(rcmer, right);}    // roll the inverted k-mer
 
             if (pos+1 - begin >= kmer::k) {
-                rcmer = kmer;
-		        // Test for multitables
-		        bool reversed = false;
-                if (reverse) {reversed = kmer::reverse_represent(rcmer);}    // invert the k-mer, if necessary
+                kmer_t canonical = reverse && rcmer < kmer ? rcmer : kmer;    // invert the k-mer, if necessary
 
                 if (sequence_order.size() == m) {
                     value_order.erase(*sequence_order.begin());    // remove k-mer outside the window
                     sequence_order.erase(sequence_order.begin());
                 }
-                value_order.emplace(rcmer);    // insert k-mer ordered by its lexicographical value
-                sequence_order.emplace_back(rcmer);
+                value_order.emplace(canonical);    // insert k-mer ordered by its lexicographical value
+                sequence_order.emplace_back(canonical);
 
                 if (sequence_order.size() == m) {
                     bin = compute_bin(*value_order.begin());
@@ -860,13 +1253,16 @@ next_kmer:
  * @return true if allowed, false otherwise
  */
 bool graph::isAllowedChar(uint64_t pos, string &str) {
-    bool allowed = false;
-    char &currentChar = str[pos];
+    return isAllowedChar(str[pos]);
+}
 
-    for (int i = 0; i < graph::allowedChars.size() && !allowed; i++){
-        allowed =  graph::allowedChars.at(i) == currentChar;
-    }
-    return allowed;
+/**
+ * This function checks if the given character is allowed.
+ * @param c upper case character
+ * @return true if allowed, false otherwise
+ */
+bool graph::isAllowedChar(const char& c) {
+    return encoder::code(c) != encoder::invalid_code;
 }
 
 /**
@@ -883,8 +1279,8 @@ void graph::add_kmers(uint64_t& T, string& str, uint16_t& color, bool& reverse,
     uint_fast32_t bin = 0;
 
     if (!isAmino) {
-        hash_set<kmer_t> ping;    // create a new empty set for the k-mers
-        hash_set<kmer_t> pong;    // create another new set for the k-mers
+        hash_map<kmer_t, kmer_t> ping;    // create a new empty set for the k-mers (and their reverse complements)
+        hash_map<kmer_t, kmer_t> pong;    // create another new set for the k-mers
         bool ball; bool wait;    // indicates which of the two sets should be used
 
         vector<uint8_t> factors;    // stores the multiplicity of iupac bases
@@ -900,7 +1296,7 @@ void graph::add_kmers(uint64_t& T, string& str, uint16_t& color, bool& reverse,
 
         ping.clear(); pong.clear(); factors.clear();
         ball = true; wait = false; product = 1;
-        (ball ? ping : pong).emplace(kmer);
+        (ball ? ping : pong).emplace(kmer, rcmer);
 
         for (; pos < str.length(); ++pos) {    // collect the bases from the string
             if (str[pos] == '.' || str[pos] == '-') {
@@ -919,10 +1315,8 @@ void graph::add_kmers(uint64_t& T, string& str, uint16_t& color, bool& reverse,
             } else { wait = true; continue; }
 
             if (pos+1 - begin >= kmer::k) {
-                for (auto& kmer : (ball ? ping : pong)) {    // iterate over the current set of ambiguous k-mers
-                    rcmer = kmer;
-
-                    if (reverse) kmer::reverse_represent(rcmer);    // invert the k-mer, if necessary
+                for (auto& entry : (ball ? ping : pong)) {    // iterate over the current set of ambiguous k-mers
+                    rcmer = reverse && entry.second < entry.first ? entry.second : entry.first;    // invert the k-mer, if necessary
                     bin = compute_bin(rcmer);
                     emplace_kmer(T, bin, rcmer, color);    // update the k-mer with the current color
                 }
@@ -993,8 +1387,8 @@ void graph::add_minimizers(uint64_t& T, string& str, uint16_t& color, bool& reve
        multiset<kmer_t> value_order;    // k-mers ordered by their lexicographical value
        multiset<kmer_t> inner_value_order;
 
-       hash_set<kmer_t> ping;    // create a new empty set for the k-mers
-       hash_set<kmer_t> pong;    // create another new set for the k-mers
+       hash_map<kmer_t, kmer_t> ping;    // create a new empty set for the k-mers (and their reverse complements)
+       hash_map<kmer_t, kmer_t> pong;    // create another new set for the k-mers
        bool ball; bool wait;    // indicates which of the two sets should be used
 
        vector<uint8_t> factors;    // stores the multiplicity of iupac bases
@@ -1012,7 +1406,7 @@ void graph::add_minimizers(uint64_t& T, string& str, uint16_t& color, bool& reve
 
        ping.clear(); pong.clear(); factors.clear();
        ball = true; wait = false; product = 1;
-       (ball ? ping : pong).emplace(kmer);
+       (ball ? ping : pong).emplace(kmer, rcmer);
 
        for (; pos < str.length(); ++pos) {    // collect the bases from the string
            if (str[pos] == '.' || str[pos] == '-') {
@@ -1031,9 +1425,8 @@ void graph::add_minimizers(uint64_t& T, string& str, uint16_t& color, bool& reve
            } else { wait = true; continue; }
 
            if (pos+1 - begin >= kmer::k) {
-               for (auto& kmer : (ball ? ping : pong)) {    // iterate over the current set of ambiguous k-mers
-                   rcmer = kmer;
-		   if (reverse) kmer::reverse_represent(rcmer);    // invert the k-mer, if necessary
+               for (auto& entry : (ball ? ping : pong)) {    // iterate over the current set of ambiguous k-mers
+                   rcmer = reverse && entry.second < entry.first ? entry.second : entry.first;    // invert the k-mer, if necessary
                    inner_value_order.emplace(rcmer);
                }
 
@@ -1182,40 +1575,40 @@ void graph::iupac_calc(long double& product, vector<uint8_t>& factors, char& inp
 /**
  * This function shifts a base into a set of ambiguous iupac k-mers.
  *
- * @param prev set of k-mers
- * @param next set of k-mers
+ * @param prev set of k-mers, with their reverse complements
+ * @param next set of k-mers, with their reverse complements
  * @param input iupac character
  */
-void graph::iupac_shift(hash_set<kmer_t>& prev, hash_set<kmer_t>& next, char& input) {
-    kmer_t temp; char base;
+void graph::iupac_shift(hash_map<kmer_t, kmer_t>& prev, hash_map<kmer_t, kmer_t>& next, char& input) {
+    kmer_t temp; kmer_t rc; uint8_t base;
     while (!prev.empty()) {    // extend each previous k-mer
         switch (input) {
             case 'A': case 'R': case 'W': case 'M':
             case 'D': case 'H': case 'V': case 'N':
-                temp = *prev.begin(); base = 'A';
-                kmer::shift(temp, base);
-                next.emplace(temp);
+                temp = prev.begin()->first; rc = prev.begin()->second; base = util::char_to_bits('A');
+                kmer::shift(temp, base); kmer::shift_reverse(rc, base);
+                next.emplace(temp, rc);
         }
         switch (input) {
             case 'C': case 'Y': case 'S': case 'M':
             case 'B': case 'H': case 'V': case 'N':
-                temp = *prev.begin(); base = 'C';
-                kmer::shift(temp, base);
-                next.emplace(temp);
+                temp = prev.begin()->first; rc = prev.begin()->second; base = util::char_to_bits('C');
+                kmer::shift(temp, base); kmer::shift_reverse(rc, base);
+                next.emplace(temp, rc);
         }
         switch (input) {
             case 'G': case 'R': case 'S': case 'K':
             case 'B': case 'D': case 'V': case 'N':
-                temp = *prev.begin(); base = 'G';
-                kmer::shift(temp, base);
-                next.emplace(temp);
+                temp = prev.begin()->first; rc = prev.begin()->second; base = util::char_to_bits('G');
+                kmer::shift(temp, base); kmer::shift_reverse(rc, base);
+                next.emplace(temp, rc);
         }
         switch (input) {
             case 'T': case 'Y': case 'W': case 'K':
             case 'B': case 'D': case 'H': case 'N':
-                temp = *prev.begin(); base = 'T';
-                kmer::shift(temp, base);
-                next.emplace(temp);
+                temp = prev.begin()->first; rc = prev.begin()->second; base = util::char_to_bits('T');
+                kmer::shift(temp, base); kmer::shift_reverse(rc, base);
+                next.emplace(temp, rc);
         }
         prev.erase(prev.begin());
     }
@@ -1280,13 +1673,17 @@ void graph::iupac_shift_amino(hash_set<kmerAmino_t>& prev, hash_set<kmerAmino_t>
 }
 
 /**
- * This function clears color-related temporary files.
+ * This function clears the coverage filter of a file slot.
+ *
+ * @param T file slot
  */
 void graph::clear_thread(uint64_t& T) {
-    switch (quality) {
-        case 1:  case 0: break;
-        case 2:  quality_set[T].clear(); break;
-        default: quality_map[T].clear(); break;
+    for (uint64_t stripe = T * quality_stripes; stripe < (T+1) * quality_stripes; ++stripe) {
+        switch (quality) {
+            case 1:  case 0: return;
+            case 2:  isAmino ? quality_setAmino[stripe].clear() : quality_set[stripe].clear(); break;
+            default: isAmino ? quality_mapAmino[stripe].clear() : quality_map[stripe].clear(); break;
+        }
     }
 }
 
@@ -1320,73 +1717,119 @@ void graph::add_cdbg_colored_kmer(string kmer_seq, const uint16_t& kmer_color){
 */
 
 /**
- * This function iterates over the hash table and calculates the split weights.
+ * This function calculates the split weights from the k-mer counts of the color classes, or by iterating over the
+ * lock-free hash tables. The classes are processed in parallel, and added to the color table in the order of their
+ * ids, such that the result does not depend on the number of threads. The hash tables are not needed afterwards,
+ * so they are released on the way (a lock-free table as soon as it is processed), only the number of k-mers is kept.
  * 
  * @param mean weight function
  * @param min_value the minimal weight represented in the top list
  * @param verbose print progess
+ * @param thread_count number of threads
  */
-void graph::add_weights(double mean(uint32_t&, uint32_t&), double min_value, bool& verbose) {
-	
-	
+void graph::add_weights(double mean(uint32_t&, uint32_t&), double min_value, bool& verbose, uint64_t& thread_count) {
 	
     //double min_value = numeric_limits<double>::min(); // current min. weight in the top list (>0)
-    uint64_t cur=0, prog=0, next;
+    atomic<uint64_t> cur(0), prog(0);
+    mutex print_lock;
 
     // check table (Amino or base)
-    uint64_t max = 0; // table size
-    if (isAmino){for (auto table: kmer_tableAmino){max += table.size();}} // use the sum of amino table sizes
-    else {for (auto table: kmer_table){max+=table.size();}} // use the sum of base table sizes
+    uint64_t max = number_kmers(); // table size
 
     // If the tables are empty, there is nothing to be done	    
     if (max==0){
         return;
     }
-    // The iterators for the tables
-    hash_map<kmer_t, color_t>::iterator base_it;
-    hash_map<kmerAmino_t, color_t>::iterator amino_it;
-
-    // Iterate the tables
-    for (int i = 0; i < graph::table_count; i++) // Iterate all tables
-    {
-        if (!isAmino){base_it = kmer_table[i].begin();} // base table iterator
-        else {amino_it = kmer_tableAmino[i].begin();} // amino table iterator
-
-        while (true) { // process splits
-            // show progress
-            if (verbose) { 
-                next = 100*cur/max;
-                if (prog < next)  cout << "\33[2K\r" << "Accumulating splits from non-singleton k-mers... " << next << "%" << flush;
-                prog = next; cur++;
-            }
-            // update the iterator
-            color_t* color_ref; // reference of the current color
-            if (isAmino) { // if the amino table is used, update the amino iterator
-                
-                if (amino_it == kmer_tableAmino[i].end()){break;} // stop iterating if done
-                else{color_ref = &amino_it.value(); ++amino_it;} // iterate the amino table
-                }
-            else { // if the base tables is used update the base iterator
-                // Todo: Get the target hash map index from the kmer bits
-                if (base_it == kmer_table[i].end()){break;} // stop itearating if done
-                else {color_ref = &base_it.value(); ++base_it;} // iterate the base table
+    // show progress, once per table or block of classes
+    auto progress = [&] (const uint64_t& count) {
+        if (!verbose) return;
+        uint64_t next = 100*(cur += count)/max;
+        if (prog < next) {
+            lock_guard<mutex> guard(print_lock);
+            if (prog < next) {cout << "\33[2K\r" << "Accumulating splits from non-singleton k-mers... " << next << "%" << flush; prog = next;}
+        }
+    };
+    atomic<uint64_t> index(0);    // the next table to process
+    vector<thread> thread_holder;
+
+    if (lockfree) { // iterate the lock-free tables, the singleton k-mers are added by add_singleton_weights
+        vector<hash_map<color_t, array<uint32_t,2>>> tables(thread_count);    // the split weights of each thread
+        auto lambda = [&] (uint64_t thread_id) {
+            hash_map<color_t, array<uint32_t,2>>& table = tables[thread_id];
+            uint64_t count = 0;
+            auto add = [&] (const uint64_t* words) {
+                color_t color = to_color(words);
+                if (color::is_singleton(color)) return;
+                count++;
+                bool pos = color::represent(color);    // invert the color set, if necessary
+                if (color == 0) return;    // ignore empty splits
+                table[color][pos]++;    // update the weight or the inverse weight of the current color set
+            };
+            for (uint64_t i = index++; i < table_count; i = index++) {
+                if (isAmino) {
+                    atomic_kmer_tableAmino[i].for_each([&] (const kmerAmino_t& kmer, const uint64_t* words) {add(words);});
+                    atomic_kmer_tableAmino[i].clear();
+                } else {
+                    atomic_kmer_table[i].for_each([&] (const kmer_t& kmer, const uint64_t* words) {add(words);});
+                    atomic_kmer_table[i].clear();
                 }
-            // process
-            color_t& color = *color_ref;
-            bool pos = color::represent(color);    // invert the color set, if necessary
-            if (color == 0) continue;    // ignore empty splits
-            // add_weight(color, mean, min_value, pos);
-			array<uint32_t,2>& weight = color_table[color];    // get the weight and inverse weight for the color set
-			weight[pos]++; // update the weight or the inverse weight of the current color set
-		}
+                progress(count); count = 0;
+            }
+        };
+        for (uint64_t thread_id = 0; thread_id < thread_count; ++thread_id) {thread_holder.emplace_back(lambda, thread_id);}
+        for (auto& thread : thread_holder) {thread.join();}
+        for (auto& table : tables) {    // merge the split weights of the threads
+            for (auto it = table.begin(); it != table.end(); ++it) {
+                array<uint32_t,2>& weight = split_weights(it->first);
+                weight[0] += it->second[0]; weight[1] += it->second[1];
+            }
+            hash_map<color_t, array<uint32_t,2>>().swap(table);
+        }
+        return;
     }
+
+    // The k-mers are counted per color class as they are inserted (see count_class), such that each class is weighted once
+    max = class_counts.size();    // the progress is measured in color classes
+    // process, the classes are represented in blocks in parallel, and the blocks are added in order
+    atomic<uint64_t> block(0), added(0);    // the next block to represent, and to add
+    auto add_classes = [&] () {
+        for (uint64_t i = index++; i < table_count; i = index++) {    // the classes of the k-mers are counted already
+            if (isAmino) {hash_map<kmerAmino_t, uint32_t>().swap(kmer_tableAmino[i]);}
+            else {hash_map<kmer_t, uint32_t>().swap(kmer_table[i]);}
+        }
+        vector<pair<color_t, bool>> splits;    // the represented color sets of a block, and if they are inverted
+        for (uint64_t b = block++; b * class_block_size < class_counts.size(); b = block++) {
+            uint64_t first = b * class_block_size, last = min<uint64_t>(first + class_block_size, class_counts.size());
+            splits.clear();
+            for (uint64_t id = first; id < last; ++id) {
+                if (class_counts[id] == 0 || is_singleton_class(id)) {splits.emplace_back(0b0u, false); continue;}    // singleton k-mers are added by add_singleton_weights
+                color_t color = color_classes[id];
+                bool pos = color::represent(color);    // invert the color set, if necessary
+                splits.emplace_back(color, pos);
+            }
+            while (added.load(memory_order_acquire) != b) {this_thread::yield();}    // wait for the previous blocks
+            for (uint64_t id = first; id < last; ++id) {
+                const pair<color_t, bool>& split = splits[id - first];
+                if (split.first == 0) continue;    // ignore empty splits
+                array<uint32_t,2>& weight = split_weights(split.first);    // get the weight and inverse weight for the color set
+                weight[split.second] += class_counts[id]; // update the weight or the inverse weight of the current color set
+            }
+            added.store(b + 1, memory_order_release);
+            progress(last - first);
+        }
+    };
+    hash_map<color_t, uint32_t>().swap(color_class_ids);    // no more classes are added
+    for (uint64_t thread_id = 0; thread_id < thread_count; ++thread_id) {thread_holder.emplace_back(add_classes);}
+    for (auto& thread : thread_holder) {thread.join();}
+    vector<color_t>().swap(color_classes);
+    vector<int64_t>().swap(class_counts);
 }
 
 
 
 
 /**
- * This function iterates over the singleton tables and adds the split weights.
+ * This function iterates over the singleton counters and adds the split weights.
  * 
  * @param mean weight function
  * @param min_value the minimal weight represented in the top list
@@ -1394,10 +1837,6 @@ void graph::add_weights(double mean(uint32_t&, uint32_t&), double min_value, boo
  */
 void graph::add_singleton_weights(double mean(uint32_t&, uint32_t&), double min_value, bool& verbose) {
 	
-	// not needed anymore
-	singleton_kmer_table.clear();
-	singleton_kmer_tableAmino.clear();	
-	
     //double min_value = numeric_limits<double>::min(); // current min. weight in the top list (>0)
     uint64_t cur=0, prog=0, next;
 
@@ -1427,13 +1866,35 @@ void graph::add_singleton_weights(double mean(uint32_t&, uint32_t&), double min_
 			color.set(i);
             // process
             // add_weight(color, mean, min_value, pos);
-			array<uint32_t,2>& weight = color_table[color];    // get the weight and inverse weight for the color set
+			array<uint32_t,2>& weight = split_weights(color);    // get the weight and inverse weight for the color set
 			weight[0]+=singleton_counters[i]; // update the weight or the inverse weight of the current color set
     }
 }
 
 
 
+/**
+ * This function calls a function for each color set with weights, in the color table or the array.
+ * The array is scanned in the order of the color sets, skipping the color sets without k-mers.
+ *
+ * @param func function of the color set and its weights
+ */
+template <typename F>
+void graph::for_each_split(F func)
+{
+	if (!dense_color_table.empty()) {
+		for (uint64_t i = 0; i < dense_color_table.size(); ++i) {
+			const array<uint32_t,2>& weights = dense_color_table[i];
+			if (weights[0] == 0 && weights[1] == 0) continue;
+			func(color_t((uint1N_t) i), weights);
+		}
+		return;
+	}
+	for (auto it = color_table.begin(); it != color_table.end(); ++it) {
+		func(it->first, it->second);
+	}
+}
+
 /**
  * This function calculates the weight for all splits and puts them into the split_ölist
  * @param mean weight function
@@ -1441,31 +1902,15 @@ void graph::add_singleton_weights(double mean(uint32_t&, uint32_t&), double min_
  */
 void graph::compile_split_list(double mean(uint32_t&, uint32_t&), double min_value)
 {
-	// Iterating over the map using Iterator till map end.
-	hash_map<color_t, array<uint32_t,2>>::iterator it = color_table.begin();
-	while (it != color_table.end())	{
-
-		// Accessing the key
-		color_t colors = it->first;
-		
-		// Accessing the value
-		array<uint32_t,2> weights = it->second;
-		
-		//insert into split list
-		double new_mean = mean(weights[0], weights[1]);    // calculate the mean value
-		if (new_mean >= min_value) {    // if it is greater than the min. value, add it to the top list
-			split_list.emplace(new_mean, colors);    // insert it at the correct position ordered by weight
-			if (split_list.size() > t) {
-				split_list.erase(--split_list.end());    // if the top list exceeds its limit, erase the last entry
-				min_value = split_list.rbegin()->first;    // update the min. value for the next iteration (only necessary of t is exceeded, otherwise min_value does not play a role.
-			}
-		}
-		
-		// iterator incremented to point next item
-		it++;
-	}
+	top_splits top(t, min_value);    // the splits are selected in a flat buffer, only the top list is sorted
+	// Iterating over the color table
+	for_each_split([&] (const color_t& colors, array<uint32_t,2> weights) {
+		top.add(mean(weights[0], weights[1]), colors);    // calculate the mean value, and add it to the top list if it is large enough
+	});
+	top.move_to(split_list);    // insert them ordered by weight
 }
 
+
 /**
  * This function determines the core k-mers, i.e., all k-mers present in all genomes.
  * Core k-mers are output to given file in fasta format, one k-mer per entry
@@ -1477,17 +1922,47 @@ void graph::output_core(ostream& file, bool& verbose)
     uint64_t cur=0, prog=0, next, core_count=0, all_count=0, singletons_count=0;
 
     // check table (Amino or base)
-    uint64_t max = 0; // table size
-    if (isAmino){for (auto table: kmer_tableAmino){max += table.size();}} // use the sum of amino table sizes
-    else {for (auto table: kmer_table){max+=table.size();}} // use the sum of base table sizes
+    uint64_t max = number_kmers(); // table size
 
     // If the tables are empty, there is nothing to be done	    
     if (max==0){
         return;
     }
+    if (lockfree) { // iterate the lock-free tables, skipping the singleton k-mers
+        auto core = [&] (const uint64_t* words) {
+            color_t color = to_color(words);
+            if (color::is_singleton(color)) return false;
+            if (verbose) { 
+                next = 100*cur/max;
+                if (prog < next)  cout << "\33[2K\r" << "Collecting core k-mers... " << next << "%" << flush;
+                prog = next; cur++;
+            }
+            all_count++;
+            if (!color::is_complete(color)) return false;
+            core_count++;
+            return true;
+        };
+        for (uint64_t i = 0; i < table_count; i++) {
+            if (isAmino) {
+                atomic_kmer_tableAmino[i].for_each([&] (const kmerAmino_t& kmer, const uint64_t* words) {
+                    kmerAmino_t kmerAmino = kmer;
+                    if (core(words)) file << ">" << endl << kmerAmino::kmer_to_string(kmerAmino) << endl;
+                });
+            } else {
+                atomic_kmer_table[i].for_each([&] (const kmer_t& kmer, const uint64_t* words) {
+                    kmer_t base = kmer;
+                    if (core(words)) file << ">" << endl << kmer::kmer_to_string(base) << endl;
+                });
+            }
+        }
+        if (verbose) { 
+            cout  << "\33[2K\r" << "Collecting core k-mers... (" << core_count << " / "<< (100*core_count/all_count) << "%)"<< flush;
+        }
+        return;
+    }
     // The iterators for the tables
-    hash_map<kmer_t, color_t>::iterator base_it;
-    hash_map<kmerAmino_t, color_t>::iterator amino_it;
+    hash_map<kmer_t, uint32_t>::iterator base_it;
+    hash_map<kmerAmino_t, uint32_t>::iterator amino_it;
 
     // Iterate the tables
     for (int i = 0; i < graph::table_count; i++) // Iterate all tables
@@ -1496,14 +1971,8 @@ void graph::output_core(ostream& file, bool& verbose)
         else {amino_it = kmer_tableAmino[i].begin();} // amino table iterator
 
         while (true) { // process splits
-            // show progress
-            if (verbose) { 
-                next = 100*cur/max;
-                if (prog < next)  cout << "\33[2K\r" << "Collecting core k-mers... " << next << "%" << flush;
-                prog = next; cur++;
-            }
             // update the iterator
-            color_t* color_ref; // reference of the current color
+            uint32_t* color_ref; // reference of the current color class
             kmer_t kmer;
 			kmerAmino_t kmerAmino;
             if (isAmino) { // if the amino table is used, update the amino iterator
@@ -1516,7 +1985,14 @@ void graph::output_core(ostream& file, bool& verbose)
                 else {kmer = base_it.key(); color_ref = &base_it.value(); ++base_it;} // iterate the base table
             }
             // process
-            color_t& color = *color_ref;
+            if (is_singleton_class(*color_ref)) continue;    // skip the singleton k-mers
+            // show progress
+            if (verbose) { 
+                next = 100*cur/max;
+                if (prog < next)  cout << "\33[2K\r" << "Collecting core k-mers... " << next << "%" << flush;
+                prog = next; cur++;
+            }
+            color_t& color = color_classes[*color_ref];
 			all_count++;
 			// is core?
 			if(color::is_complete(color)){
@@ -1538,17 +2014,11 @@ void graph::output_core(ostream& file, bool& verbose)
 
 
 /**
- * Get the number of k-mers in all tables.
- * @return number of k-mers in all tables.
+ * Get the number of non-singleton k-mers in all tables.
+ * @return number of non-singleton k-mers in all tables.
  */
 uint64_t graph::number_kmers(){
-	uint64_t num=0;
-	if (isAmino){ // use the sum of amino table sizes
-		for (auto table: kmer_tableAmino){num += table.size();}
-	} else { // use the sum of base table sizeskmer_table.size(); 
-		for (auto table: kmer_table){num+=table.size();}
-	}
-	return num;
+	return kmer_count; // counted as the k-mers are inserted (see flush), or by compact
 }
 
 
@@ -1567,6 +2037,7 @@ uint64_t graph::number_singleton_kmers(){
 
 /**
  * This function generates a bootstrap replicate. We mimic drawing n k-mers at random with replacement from all n observed k-mers. Say a k-mer would be drawn x times. Instead, we calculate x for each k-mer (in each split in color_table) from a binomial distribution (n repetitions, 1/n success rate) and calculate a new split weight according to the new number of k-mers.
+ * The sum of the draws of the w k-mers of a split is drawn at once from a binomial distribution (w*n repetitions, 1/n success rate), such that a replicate takes one draw per split.
  * @param mean weight function
  * @return the new list of splits of length at least t ordered by weight as usual
  */
@@ -1574,52 +2045,26 @@ multimap_<double, color_t> graph::bootstrap(double mean(uint32_t&, uint32_t&)) {
 
 	uint64_t max = graph::number_kmers();
 
-	std::random_device rd;
-	std::mt19937 gen(rd());
+	static thread_local wyrand gen([] () {random_device rd; return (uint64_t) rd() << 32 | rd();} ());    // seeded once per thread
 
 	multimap_<double, color_t> sl;
-	double min_value=0;
-
-	// perform n time max trials, each succeeds 1/max
-	std::binomial_distribution<> d(max, 1.0/max);
-	
-	// Iterating over the map using Iterator till map end.
-	hash_map<color_t, array<uint32_t,2>>::iterator it = color_table.begin();
-	while (it != color_table.end())	{
+	top_splits top(t, 0);    // the splits are selected in a flat buffer, only the top list is sorted
 
-		// Accessing the key
-		color_t colors = it->first;
-		
-		// Accessing the value
-		array<uint32_t,2> weights = it->second;
+	// Iterating over the color table
+	for_each_split([&] (const color_t& colors, const array<uint32_t,2>& weights) {
 		
-		// bootstrap the number of kmer occurrences for split and inverse
+		// bootstrap the number of kmer occurrences for split and inverse: the sum of w draws of n time max trials,
+		// each succeeding 1/max, is a single draw of w*max trials
 		array<uint32_t,2> new_weights;
-		new_weights[0]=0;
-		new_weights[1]=0;
 		for (int i=0;i<2;i++) {
-			for (int r=0;r<weights[i];r++){
-				new_weights[i] += d(gen);
-			}
-// 			uint64_t n = weights[i]*max;
-// 			std::binomial_distribution<> dn(n, 1.0/max);
-// 			cout << weights[i] << "\t" << dn(gen) << "\t" << new_weights[i] << "\n" << flush;
+			binomial_distribution<uint64_t> d((uint64_t) weights[i] * max, 1.0/max);
+			new_weights[i] = weights[i] ? d(gen) : 0;
 		}
 		
 		//insert into new split list
-		double new_mean = mean(new_weights[0], new_weights[1]);    // calculate the new mean value
-		if (new_mean >= min_value) {    // if it is greater than the min. value, add it to the top list
-			sl.emplace(new_mean, colors);    // insert it at the correct position ordered by weight
-			if (sl.size() > t) {
-				sl.erase(--sl.end());    // if the top list exceeds its limit, erase the last entry
-				min_value = sl.rbegin()->first;    // update the min. value for the next iteration (only necessary of t is exceeded, otherwise min_value does not play a role.
-			}
-		}
-		
-		// iterator incremented to point next item
-		it++;
-		
-	}
+		top.add(mean(new_weights[0], new_weights[1]), colors);    // calculate the new mean value
+	});
+	top.move_to(sl);
 
 	return sl;
 }
@@ -1970,4 +2415,4 @@ string graph::print_tree(node* root, std::function<string(const uint16_t&)> map,
     }
 }
 
-
+END_WIDTH
@@ -48,6 +48,10 @@ template <typename K, typename V>
 
 
 #include "color.h"
+#include "encoder.h"
+#include "atomic_table.h"
+
+BEGIN_WIDTH
 
 
 /**
@@ -59,6 +63,16 @@ struct node {
     vector<node*> subsets;
 };
 
+/**
+ * The rolling k-mer state of a sequence that is read in several pieces (e.g., line by line).
+ */
+struct kmer_state {
+    kmer_t kmer;    // the current k-mer
+    kmer_t rcmer;    // the reverse complement of the current k-mer
+    kmerAmino_t kmerAmino;    // the current amino k-mer
+    uint64_t length;    // number of consecutive allowed characters read so far
+};
+
 /**
 * A spinlock implementation
 * source: https://rigtorp.se/spinlock/
@@ -97,6 +111,114 @@ struct spinlock {
   }
 };
 
+/**
+ * A spinlock on a cache line of its own, such that neighboring locks are not falsely shared.
+ */
+struct alignas(64) padded_spinlock : spinlock {};
+
+/**
+ * A change of the number of k-mers of a color class.
+ */
+struct class_delta {
+    uint32_t id;    // the color class
+    int64_t count;    // the change of its k-mer count
+};
+
+/**
+ * The k-mers of a thread waiting to be inserted into the hash tables, buffered per shard group.
+ * A full group is flushed under a single lock acquisition.
+ */
+template <typename K>
+struct insert_buffer {
+    struct entry {
+        K kmer;    // the k-mer
+        uint32_t bin;    // its hash_map vector index
+        uint16_t color;    // its color
+    };
+    vector<entry> entries;    // the entries of group g are [g*capacity, g*capacity + fill[g])
+    vector<uint16_t> fill;    // the number of entries of each group
+
+    struct pending {
+        K kmer;    // the k-mer
+        uint64_t hash;    // its hash value
+        uint32_t bin;    // its hash_map vector index
+        uint16_t color;    // its color
+    };
+    vector<pending> ahead;    // the k-mers whose slots are prefetched (lock-free tables), a ring buffer
+    uint64_t ahead_pos = 0;    // the position of the oldest k-mer in the ring
+
+    struct cached {
+        K kmer;    // the k-mer
+        uint32_t bin;    // its hash_map vector index
+        uint16_t color;    // its color
+        uint16_t count;    // its occurrences not yet passed to the coverage filter, or inserted (0: empty)
+    };
+    vector<cached> cache;    // the recent k-mers of this thread (coverage filter only), direct-mapped by hash value
+    uint64_t pending = 0;    // the number of cached k-mers whose occurrences are not yet passed to the coverage filter
+    uint64_t slot = 0;    // the file slot of these occurrences
+    int64_t singletons[maxN] = {};    // the change of the singleton counters by this thread
+    int64_t kmers = 0;    // the change of the number of non-singleton k-mers by this thread
+    vector<class_delta> classes;    // the change of the class counts by this thread, direct-mapped by class
+    vector<class_delta> evicted;    // the changes replaced in classes, waiting to be added to the class counts
+};
+
+
+/**
+ * A memoized transition between color classes: the class of a color set with a color added.
+ */
+struct class_transition {
+    uint32_t from;    // the color class
+    uint32_t to;    // the color class with the color added
+    uint16_t color;    // the added color
+};
+
+
+/**
+ * A bounded selection of the best splits by weight (see compile_split_list, bootstrap).
+ * The candidates are collected in a flat buffer, which is cut down to the best t whenever it holds twice as many,
+ * such that only the final t splits are sorted and put into a list.
+ */
+struct top_splits {
+    vector<pair<double, color_t>> entries;    // the candidates, among them the best t
+    uint64_t t;    // the number of splits to select
+    double min_value;    // the min. weight of a candidate that could still be selected
+
+    top_splits(const uint64_t& t, const double& min_value) : t(t), min_value(min_value) {}
+
+    /**
+     * This function adds a candidate split.
+     *
+     * @param weight split weight
+     * @param color split colors
+     */
+    void add(const double& weight, const color_t& color) {
+        if (weight < min_value) return;
+        entries.emplace_back(weight, color);
+        if (entries.size() > t && entries.size() - t >= t) cut();
+    }
+
+    /**
+     * This function keeps the best t candidates (in the order of compare), the others cannot be selected anymore.
+     */
+    void cut() {
+        nth_element(entries.begin(), entries.begin() + t, entries.end(), compare<double, color_t>());
+        min_value = max(min_value, entries[t].first);    // the best candidate that is not kept
+        entries.erase(entries.begin() + t, entries.end());
+    }
+
+    /**
+     * This function puts the selected splits into a list, which is limited to t splits.
+     *
+     * @param list list of splits
+     */
+    void move_to(multimap_<double, color_t>& list) {
+        if (entries.size() > t) cut();
+        sort(entries.begin(), entries.end(), compare<double, color_t>());
+        for (auto& entry : entries) list.emplace_hint(list.end(), entry);
+        while (list.size() > t) list.erase(--list.end());
+        entries.clear();
+    }
+};
 
 
 /**
@@ -131,50 +253,245 @@ private:
     static uint64_t table_count;
     
     /**
-     * This vector holds the carries of 2**i % table_count for fast distribution of bitset represented kmers
+     * This is a vector of hash tables mapping k-mers to color classes [O(1)].
+     */
+    static vector<hash_map<kmer_t, uint32_t>> kmer_table;
+
+    /**
+     * These are the distinct color sets of the k-mers (color classes), each stored once.
+     * Class 0 is the empty set, classes 1 to maxN are the singleton sets (see singleton_class).
+     */
+    static vector<color_t> color_classes;
+
+    /**
+     * This function returns the class of a single color, the singleton k-mers are stored with these classes.
+     *
+     * @param color color
+     * @return color class
+     */
+    static inline uint32_t singleton_class(const uint16_t& color) {
+        return color + 1;
+    }
+
+    /**
+     * This function checks if a color class is a single color.
+     *
+     * @param id color class
+     * @return true, if it is a singleton class
+     */
+    static inline bool is_singleton_class(const uint32_t& id) {
+        return id - 1 < maxN;
+    }
+
+    /**
+     * This is a hash table mapping color sets to their classes [O(1)].
+     */
+    static hash_map<color_t, uint32_t> color_class_ids;
+
+    /**
+     * This is a spinlock protecting the color classes.
+     */
+    static spinlock color_class_lock;
+
+    /**
+     * This is the number of k-mers of each color class, kept up to date as the k-mers are inserted, such that the
+     * split weights are computed without iterating the hash tables. The singleton classes are counted by singleton_counters.
+     */
+    static vector<int64_t> class_counts;
+
+    /**
+     * This is a spinlock protecting the class counts.
+     */
+    static spinlock class_counts_lock;
+
+    /**
+     * This is the number of class count changes collected per thread, direct-mapped by class.
+     */
+    static const uint64_t class_cache_size = 4096;
+
+    /**
+     * This is the number of replaced class count changes of a thread that are added under a single lock acquisition.
+     */
+    static const uint64_t class_flush_size = 1024;
+
+    /**
+     * This function changes the k-mer count of a color class, collected in the buffer of the current thread.
+     *
+     * @param buffer buffer of the current thread
+     * @param id color class
+     * @param change change of the count
+     */
+    template <typename K>
+    static void count_class(insert_buffer<K>& buffer, const uint32_t& id, const int64_t& change);
+
+    /**
+     * This function adds changes to the class counts.
+     *
+     * @param deltas changes of the class counts, cleared afterwards
+     */
+    static void add_class_counts(vector<class_delta>& deltas);
+
+    /**
+     * This is the number of class transitions memoized per thread.
+     */
+    static const uint64_t transition_cache_size = 4096;
+
+    /**
+     * These are the recent class transitions of the current thread (class + color -> class), direct-mapped.
+     */
+    static thread_local vector<class_transition> transitions;
+
+    /**
+     * This function returns the class of a color set with a color added, memoized per thread.
+     *
+     * @param id color class
+     * @param color color to add
+     * @return color class
+     */
+    static uint32_t add_color(const uint32_t& id, const uint16_t& color);
+
+    /**
+     * This is a vector of spinlocks protecting the hash tables, one per group of group_size tables.
+     */
+    static vector<padded_spinlock> lock;
+
+    /**
+     * This is the number of hash tables per lock and insert buffer group.
+     */
+    static const uint64_t group_size = 16;
+
+    /**
+     * This is the number of k-mers buffered per group before they are inserted.
+     */
+    static const uint64_t buffer_size = 32;
+
+    /**
+     * This is the number of recent k-mers cached per thread, such that repeated k-mers of a file are counted and
+     * inserted without locks (coverage filter only). It takes 16 MB per thread for k <= 32.
      */
-    static vector<uint_fast32_t> period;
+    static const uint64_t cache_size = 1 << 20;
+
     /**
-     * This is a vector of hash tables mapping k-mers to colors [O(1)].
+     * This is the count of a cached k-mer whose color is inserted already.
      */
-    static vector<hash_map<kmer_t, color_t>> kmer_table;
+    static const uint16_t inserted = UINT16_MAX;
 
     /**
-     * This is a vector of spinlocks protecting the hash tables.
+     * These are the k-mers of the current thread waiting to be inserted.
      */
-    static vector<spinlock> lock;
+    static thread_local insert_buffer<kmer_t> buffer;
+    static thread_local insert_buffer<kmerAmino_t> buffer_amino;
 
     /**
-     * This is a hash table mapping k-mers to colors [O(1)].
+     * This is a hash table mapping amino k-mers to color classes [O(1)].
      */
-    static vector<hash_map<kmerAmino_t, color_t>> kmer_tableAmino;
+    static vector<hash_map<kmerAmino_t, uint32_t>> kmer_tableAmino;
 
     /**
      * This is a hash table mapping colors to weights [O(1)].
      */
     static hash_map<color_t, array<uint32_t,2>> color_table;
 
+    /**
+     * This is the max. number of colors, for which the weights are stored in an array indexed by the color set instead.
+     */
+    static const uint64_t dense_colors = 20;
+
+    /**
+     * This is an array mapping colors to weights, used instead of color_table for few colors (see dense_colors).
+     */
+    static vector<array<uint32_t,2>> dense_color_table;
+
+    /**
+     * This function returns the weight and inverse weight of a color set.
+     *
+     * @param color color set
+     * @return weights
+     */
+    static inline array<uint32_t,2>& split_weights(const color_t& color) {
+        if (!dense_color_table.empty()) return dense_color_table[color.data()[0]];
+        return color_table[color];
+    }
+
+    /**
+     * This function calls a function for each color set with weights, in the color table or the array.
+     *
+     * @param func function of the color set and its weights
+     */
+    template <typename F>
+    static void for_each_split(F func);
+
+    /**
+     * This is the number of color classes represented at a time by a thread (see add_weights).
+     */
+    static const uint64_t class_block_size = 4096;
+
+    /**
+     * This is the number of stripes of the coverage filter of each file slot.
+     */
+    static const uint64_t quality_stripes = 64;
+
     /**
      * This is a hash set used to filter k-mers for coverage (q > 1).
+     * There is one per file slot and stripe (i.e., slot * quality_stripes + bin % quality_stripes),
+     * as the chunks of a file are processed by several threads.
      */
     static vector<hash_set<kmer_t>> quality_set;
     static vector<hash_set<kmerAmino_t>> quality_setAmino;
 
-	static vector<hash_map<kmer_t, uint16_t>> singleton_kmer_table;
-	static vector<hash_map<kmerAmino_t, uint16_t>> singleton_kmer_tableAmino;
+    /**
+     * This is a vector of spinlocks protecting the coverage filter stripes.
+     */
+    static vector<spinlock> quality_lock;
+
+    /**
+     * This is the number of 64-bit words of a color set.
+     */
+    static const uint64_t color_words = (maxN + 63) / 64;
+
+    /**
+     * These are lock-free hash tables mapping k-mers to colors, used instead of kmer_table if lockfree is set.
+     * They hold the singleton k-mers as well, which are counted when all k-mers are inserted (see compact).
+     */
+    static vector<atomic_table<kmer_t, color_words>> atomic_kmer_table;
+    static vector<atomic_table<kmerAmino_t, color_words>> atomic_kmer_tableAmino;
+
+    /**
+     * This indicates that the lock-free hash tables are used.
+     */
+    static bool lockfree;
+
+    /**
+     * This is the number of non-singleton k-mers, counted as they are inserted (see flush), or in the lock-free
+     * hash tables (see compact). It is kept when the hash tables are released (see add_weights).
+     */
+    static uint64_t kmer_count;
+
+    /**
+     * This function converts the color words of a lock-free hash table entry.
+     *
+     * @param words color words
+     * @return color set
+     */
+    static color_t to_color(const uint64_t* words);
 	static uint64_t singleton_counters[];
-	static spinlock singleton_counters_locks[];
+	static spinlock singleton_counters_lock;
 
 	
 	
     /**
-     * This is a hash map used to filter k-mers for coverage (q > 2).
+     * This is a hash map used to filter k-mers for coverage (q > 2), striped as the hash set.
      */
     static vector<hash_map<kmer_t, uint16_t>> quality_map;
     static vector<hash_map<kmerAmino_t, uint16_t>> quality_mapAmino;
 
 public:
 
+    /**
+     * This is the number of k-mers whose slots in the lock-free hash tables are prefetched ahead of their insertion (0: off).
+     */
+    static uint64_t prefetch;
+
 	/**
 	* This function generates a bootstrap replicate. We mimic drawing n k-mers at random with replacement from all n observed k-mers. Say a k-mer would be drawn x times. Instead, we calculate x for each k-mer (in each split in color_table) from a binomial distribution (n repetitions, 1/n success rate) and calculate a new split weight according to the new number of k-mers.
 	* @param mean weight function
@@ -203,8 +520,9 @@ public:
 	 * @param blacklist_amino amino k-mers to be ignored
      * @param bins hash_tables to use for parallel processing
      * @param thread_count the number of threads used for processing
+     * @param lockfree use the lock-free hash tables
      */
-    static void init(uint64_t& top_size, bool isAmino, vector<int>& q_table, int& quality, hash_set<kmer_t>& blacklist, hash_set<kmerAmino_t>& blacklist_amino, uint64_t& thread_count);
+    static void init(uint64_t& top_size, bool isAmino, vector<int>& q_table, int& quality, hash_set<kmer_t>& blacklist, hash_set<kmerAmino_t>& blacklist_amino, uint64_t& thread_count, bool lockfree);
 
 
 
@@ -213,30 +531,15 @@ public:
     */
     
     /**
-     * This function shift updates the bin of a kmer
-    */
-    static uint_fast32_t shift_update_bin(uint_fast32_t& bin, uint_fast8_t& left, uint_fast8_t& right);
-    
-    /**
-     * This method shift updates the reverse complement bin for a kmer
-    */
-    static uint_fast32_t shift_update_rc_bin(uint_fast32_t& rc_bin, uint_fast8_t& left, uint_fast8_t& right);
-
-    /**
-    * This function shift updates a bin for an amino kmer
-    */
-    static uint_fast32_t shift_update_amino_bin(uint_fast32_t& bin, kmerAmino_t& kmer, uint_fast8_t& right);
-
-    /**
-     *  This method computes the bin of a given kmer(slower than shift update)
+     * This function computes the bin of a given kmer from the high bits of its hash value
+     * (the hash tables use the low bits).
      * @param kmer The target kmer
      * @return uint64_t The bin
      */
-     
     static uint_fast32_t compute_bin(const kmer_t& kmer);
 
     /**
-     *  This function computes the bin of a given amino kmer(slower than shift update)
+     *  This function computes the bin of a given amino kmer from the high bits of its hash value
      * @param kmer The target kmer
      * @return uint64_t The bin
      */
@@ -258,6 +561,56 @@ public:
      */
     static void hash_kmer_amino(uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color);
 
+    /**
+     * This function stores a k-mer in its hash table, the lock of its group has to be held.
+     *  @param bin   Index of the target hash map 
+     *  @param kmer  The k-mer to store
+     *  @param color The color to store 
+     */
+    static void store_kmer(const uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color);
+
+    /**
+     * This function stores an amino k-mer in its hash table, the lock of its group has to be held.
+     *  @param bin   Index of the target hash map 
+     *  @param kmer  The k-mer to store
+     *  @param color The color to store 
+     */
+    static void store_kmer_amino(const uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color);
+
+    /**
+     * This function buffers a k-mer of the current thread, the group of its hash table is flushed when full.
+     *  @param bin   Index of the target hash map 
+     *  @param kmer  The k-mer to store
+     *  @param color The color to store 
+     */
+    static void buffer_kmer(uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color);
+
+    /**
+     * This function buffers an amino k-mer of the current thread, the group of its hash table is flushed when full.
+     *  @param bin   Index of the target hash map 
+     *  @param kmer  The k-mer to store
+     *  @param color The color to store 
+     */
+    static void buffer_kmer_amino(uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color);
+
+    /**
+     * This function passes the occurrences of a cached k-mer to the coverage filter, it is inserted if they are enough.
+     *  @param T     The file slot
+     *  @param bin   Index of the target hash map
+     *  @param kmer  The k-mer
+     *  @param count The number of occurrences
+     *  @param color The color
+     */
+    static void count_kmer(const uint64_t& T, uint_fast32_t bin, const kmer_t& kmer, const uint16_t& count, const uint16_t& color);
+    static void count_kmer_amino(const uint64_t& T, uint_fast32_t bin, const kmerAmino_t& kmer, const uint16_t& count, const uint16_t& color);
+
+    /**
+     * This function stores the buffered k-mers of a group under a single lock acquisition.
+     *  @param group index of the group
+     */
+    static void flush_group(const uint64_t& group);
+    static void flush_group_amino(const uint64_t& group);
+
     /**
      * This function searches the bit-wise corresponding hash table for the given kmer
      * @param kmer The kmer to search
@@ -322,6 +675,25 @@ public:
      */
     static void add_kmers(uint64_t& T, string& str, uint16_t& color, bool& reverse);
 
+    /**
+     * This function extracts k-mers from a piece of a sequence and adds them to the hash table.
+     * The k-mer state is carried over from the previous piece, so a sequence can be passed line by line.
+     *
+     * @param str first character of the piece (upper or lower case)
+     * @param length number of characters
+     * @param state rolling k-mer state of the sequence
+     * @param color color flag
+     * @param reverse merge complements
+     */
+    static void add_kmers(uint64_t& T, const char* str, const uint64_t& length, kmer_state& state, uint16_t& color, bool& reverse);
+
+    /**
+     * This function resets a rolling k-mer state at the beginning of a new sequence.
+     *
+     * @param state rolling k-mer state
+     */
+    static void reset(kmer_state& state);
+
     /**
      * This function extracts k-mer minimizers from a sequence and adds them to the hash table.
      *
@@ -370,14 +742,14 @@ public:
 	
 	
 	/**
-	* Get the number of k-mers in all tables.
-	* @return number of k-mers in all tables.
+	* Get the number of non-singleton k-mers in all tables.
+	* @return number of non-singleton k-mers in all tables.
 	*/
 	static uint64_t number_kmers();
 	
 	/**
-	* Get the number of k-mers in all singleton tables.
-	* @return number of k-mers in all singleton tables.
+	* Get the number of singleton k-mers in all tables.
+	* @return number of singleton k-mers in all tables.
 	*/
 	static uint64_t number_singleton_kmers();
 
@@ -387,12 +759,13 @@ public:
      * @param mean weight function
      * @param verbose print progress
      * @param min_value the minimal weight currently represented in the top list
+     * @param thread_count number of threads
      */
-    static void add_weights(double mean(uint32_t&, uint32_t&), double min_value, bool& verbose);
+    static void add_weights(double mean(uint32_t&, uint32_t&), double min_value, bool& verbose, uint64_t& thread_count);
 	
 	
 	/**
-	* This function iterates over the singleton tables and adds the split weights.
+	* This function iterates over the singleton counters and adds the split weights.
 	* 
 	* @param mean weight function
 	* @param min_value the minimal weight represented in the top list
@@ -423,7 +796,29 @@ public:
      static void add_cdbg_colored_kmer(string kmer_seq, const uint16_t& kmer_color);       
 
     /**
-     * This function clears color-related temporary files.
+     * This function stores the buffered k-mers of the current thread and adds its singleton counts.
+     * Each thread that added k-mers has to call it before the hash tables are used.
+     */
+    static void flush();
+
+    /**
+     * This function passes the cached occurrences of the current thread to the coverage filter.
+     * The cached occurrences belong to one file slot, so each thread has to call it before it hashes a batch
+     * of another file, and before the coverage filter of the file is cleared.
+     */
+    static void flush_cache();
+
+    /**
+     * This function merges the lock-free hash tables and counts their singleton k-mers, after all k-mers are inserted.
+     *
+     * @param thread_count the number of threads used for processing
+     */
+    static void compact(uint64_t& thread_count);
+
+    /**
+     * This function clears the coverage filter of a file slot.
+     *
+     * @param T file slot
      */
     static void clear_thread(uint64_t& T);
 
@@ -481,23 +876,98 @@ public:
 
 protected:
 
+    /**
+     * This is the coverage filter of the insertion paths: none (q <= 1), a hash set (q = 2), or a hash map (q > 2).
+     */
+    enum filter_mode { unfiltered, filter_set, filter_map };
+
     /**
      * This function qualifies a k-mer and places it into the hash table.
+     * It points to the insertion path specialized for the coverage filter and blacklist (see select_paths).
      *
      * @param kmer bit sequence
      * @param color color flag
      */
-    static function<void(const uint64_t& T, uint_fast32_t& bin, const kmer_t&, const uint16_t&)> emplace_kmer;
-    static function<void(const uint64_t& T, uint_fast32_t& bin, const kmer_t&, const uint16_t&)> emplace_kmer_tmp;
+    static void (*emplace_kmer)(const uint64_t& T, uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color);
 
     /**
      * This function qualifies a k-mer and places it into the hash table.
+     * It points to the insertion path specialized for the coverage filter and blacklist (see select_paths).
      *
      * @param kmer bit sequence
      * @param color color flag
      */
-    static function<void(const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t&, const uint16_t&)> emplace_kmer_amino;
-    static function<void(const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t&, const uint16_t&)> emplace_kmer_amino_tmp;
+    static void (*emplace_kmer_amino)(const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color);
+
+    /**
+     * This function extracts k-mers from a piece of a sequence and adds them to the hash table.
+     * It points to the loop specialized for the coverage filter and blacklist, without [0] or with [1] merging complements.
+     */
+    static void (*add_kmers_path[2])(uint64_t& T, const char* str, const uint64_t& length, kmer_state& state, uint16_t& color);
+
+    /**
+     * This function qualifies a k-mer and places it into the hash table.
+     *
+     * @tparam Q coverage filter
+     * @tparam Table coverage threshold per color
+     * @tparam Black blacklist in use
+     * @param kmer bit sequence
+     * @param color color flag
+     */
+    template <filter_mode Q, bool Table, bool Black>
+    static void insert_kmer(const uint64_t& T, uint_fast32_t& bin, const kmer_t& kmer, const uint16_t& color);
+
+    /**
+     * This function qualifies an amino k-mer and places it into the hash table.
+     *
+     * @tparam Q coverage filter
+     * @tparam Table coverage threshold per color
+     * @tparam Black blacklist in use
+     * @param kmer bit sequence
+     * @param color color flag
+     */
+    template <filter_mode Q, bool Table, bool Black>
+    static void insert_kmer_amino(const uint64_t& T, uint_fast32_t& bin, const kmerAmino_t& kmer, const uint16_t& color);
+
+    /**
+     * This function extracts DNA k-mers from a piece of a sequence and adds them to the hash table.
+     *
+     * @tparam Q coverage filter
+     * @tparam Table coverage threshold per color
+     * @tparam Black blacklist in use
+     * @tparam Reverse merge complements
+     * @param str first character of the piece (upper or lower case)
+     * @param length number of characters
+     * @param state rolling k-mer state of the sequence
+     * @param color color flag
+     */
+    template <filter_mode Q, bool Table, bool Black, bool Reverse>
+    static void add_kmers_dna(uint64_t& T, const char* str, const uint64_t& length, kmer_state& state, uint16_t& color);
+
+    /**
+     * This function extracts amino k-mers from a piece of a sequence and adds them to the hash table.
+     *
+     * @tparam Q coverage filter
+     * @tparam Table coverage threshold per color
+     * @tparam Black blacklist in use
+     * @param str first character of the piece (upper or lower case)
+     * @param length number of characters
+     * @param state rolling k-mer state of the sequence
+     * @param color color flag
+     */
+    template <filter_mode Q, bool Table, bool Black>
+    static void add_kmers_amino(uint64_t& T, const char* str, const uint64_t& length, kmer_state& state, uint16_t& color);
+
+    /**
+     * This function selects the insertion paths for the given coverage filter and blacklist.
+     */
+    template <filter_mode Q, bool Table, bool Black>
+    static void select_paths();
+
+    /**
+     * This function selects the insertion paths for the current coverage filter and blacklist.
+     */
+    static void select_paths();
 
     /**
      * This function tests if a split is compatible with an existing set of splits.
@@ -529,11 +999,11 @@ protected:
     /**
      * This function shifts a base into a set of ambiguous iupac k-mers.
      *
-     * @param prev set of k-mers
-     * @param next set of k-mers
+     * @param prev set of k-mers, with their reverse complements
+     * @param next set of k-mers, with their reverse complements
      * @param input iupac character
      */
-    static void iupac_shift(hash_set<kmer_t>& prev, hash_set<kmer_t>& next, char& input);
+    static void iupac_shift(hash_map<kmer_t, kmer_t>& prev, hash_map<kmer_t, kmer_t>& next, char& input);
 
     /**
    * This function shifts a base into a set of ambiguous iupac k-mers.
@@ -580,4 +1050,13 @@ protected:
      * @return true if allowed, false otherwise
      */
     static bool isAllowedChar(uint64_t pos, string &str);
+
+    /**
+     * This function checks if the given character is allowed.
+     * @param c upper case character
+     * @return true if allowed, false otherwise
+     */
+    static bool isAllowedChar(const char& c);
 };
+
+END_WIDTH
@@ -0,0 +1,116 @@
+#ifndef SANS_HASH_H
+#define SANS_HASH_H
+
+
+#include <cstdint>
+
+
+/**
+ * This class provides the hash functions of the bit sequences (k-mers and colors).
+ * The raw words are structured (e.g., all k-mers of a shard would share a residue), so they are mixed by a finalizer:
+ * murmur (default), wyhash-style (-DHASH_WYMIX), or none (-DHASH_IDENTITY, the former behavior, for comparison).
+ * The hash tables use the low bits of a hash, the shards use the high bits.
+ */
+class hasher {
+
+public:
+
+    /**
+     * This function mixes a word using the finalizer of MurmurHash3.
+     *
+     * @param x word
+     * @return hash value
+     */
+    static inline uint64_t murmur(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    /**
+     * This function mixes a word using the 128-bit multiply-and-fold of wyhash.
+     *
+     * @param x word
+     * @return hash value
+     */
+    static inline uint64_t wymix(uint64_t x) {
+        __uint128_t r = (__uint128_t) (x ^ 0xa0761d6478bd642fULL) * 0xe7037ed1a0b428dbULL;
+        return (uint64_t) r ^ (uint64_t) (r >> 64);
+    }
+
+    /**
+     * This function mixes a word using the selected finalizer.
+     *
+     * @param x word
+     * @return hash value
+     */
+    static inline uint64_t mix(const uint64_t& x) {
+        #if defined(HASH_IDENTITY)
+            return x;
+        #elif defined(HASH_WYMIX)
+            return wymix(x);
+        #else
+            return murmur(x);
+        #endif
+    }
+
+    /**
+     * This function combines the hash of the previous words with the next word.
+     *
+     * @param hash hash value of the previous words
+     * @param x next word
+     * @return hash value
+     */
+    static inline uint64_t combine(const uint64_t& hash, const uint64_t& x) {
+        #if defined(HASH_IDENTITY)
+            return hash ^ x;
+        #else
+            return mix(hash ^ (x + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2)));
+        #endif
+    }
+
+    /**
+     * This function maps a hash value to one of n shards using its high bits (fast range reduction).
+     *
+     * @param hash hash value
+     * @param n number of shards
+     * @return shard index
+     */
+    static inline uint64_t shard(const uint64_t& hash, const uint64_t& n) {
+        #if defined(HASH_IDENTITY)
+            return hash % n;
+        #else
+            return ((hash >> 32) * n) >> 32;
+        #endif
+    }
+
+};
+
+/**
+ * This is a fast pseudo-random number generator (wyrand), it can be used with the distributions of <random>.
+ */
+struct wyrand {
+    using result_type = uint64_t;
+    uint64_t state;
+
+    explicit wyrand(const uint64_t& seed) : state(seed) {}
+
+    static constexpr uint64_t min() {return 0;}
+    static constexpr uint64_t max() {return UINT64_MAX;}
+
+    /**
+     * This function returns the next random number.
+     *
+     * @return random number
+     */
+    inline uint64_t operator()() {
+        state += 0xa0761d6478bd642fULL;
+        __uint128_t r = (__uint128_t) state * (state ^ 0xe7037ed1a0b428dbULL);
+        return (uint64_t) r ^ (uint64_t) (r >> 64);
+    }
+};
+
+#endif
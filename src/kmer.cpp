@@ -1,10 +1,13 @@
 #include "kmer.h"
 
+BEGIN_KMER
+
 /*
  * This class contains functions for working with k-mer types.
  */
 size2K_t kmer::k;      // length of a k-mer (including gap positions)
 kmer_t   kmer::mask;   // bit-mask to erase all bits that exceed the k-mer length
+kmer_t   kmer::complements[4];   // complement of each base at the leftmost position
 
 /**
  * This function initializes the k-mer length and bit-mask.
@@ -15,6 +18,11 @@ void kmer::init(const size2K_t& length) {
     k = length; mask = 0b0u;
     for (size2K_t i = 0; i < k; ++i)  // fill all bits within the k-mer length with ones
         (mask <<= 02u) |= 0b11u;     // the remaining zero bits can be used to mask bits
+    for (uint8_t base = 0; base < 4; ++base) {
+        complements[base] = 0b11u - base;    // complement of the base
+        for (size2K_t i = 1; i < k; ++i)     // move to the leftmost position (step-wise, as bit shifts are limited to a word)
+            complements[base] <<= 02u;
+    }
 }
 
 /**
@@ -70,6 +78,18 @@ void kmer::reverse_complement(kmer_t& kmer) {
     kmer = rcmp;
 }
 
+/**
+ * This function shifts a reverse complement k-mer, prepending the complement of a new character to the left.
+ * Applied along with shift, it keeps the reverse complement up to date in constant time.
+ *
+ * @param rcmer bit sequence of the reverse complement
+ * @param right new right character (of the forward k-mer) in binary-code
+ */
+void kmer::shift_reverse(kmer_t& rcmer, uint_fast8_t& right) {
+    rcmer >>= 02u;    // shift out the complement of the leftmost character
+    rcmer |= complements[right];    // encode the complement of the new character within the leftmost two bits
+}
+
 /**
  * This function constructs the canonical k-mer of a given k-mer.
  *
@@ -104,3 +124,4 @@ string kmer::kmer_to_string(kmer_t& kmer) {
     return kmer_string;
 }
 
+END_KMER
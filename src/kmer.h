@@ -10,10 +10,17 @@ using namespace std;
 #define INDEX_TYPE   size2K_t
 #define BIT_LENGTH   (2*maxK)
 #define LEX_INTEGER_COMPARATORS
+#define INT128_STORAGE
+#include "width.h"
+#if defined(WIDTHS)
+    #define BYTE_NAMESPACE KMER_NAME(maxK)
+#endif
 #include "byte.h"
 
 #include "util.h"
 
+BEGIN_KMER
+
 /**
  * This class contains functions for working with k-mer types.
  */
@@ -26,6 +33,11 @@ class kmer {
      */
     static kmer_t mask;
 
+    /**
+     * These are the complements of the four bases at the leftmost position of a k-mer.
+     */
+    static kmer_t complements[4];
+
  public:
 
     /**
@@ -73,6 +85,15 @@ class kmer {
      */
     static void reverse_complement(kmer_t& kmer);
 
+    /**
+     * This function shifts a reverse complement k-mer, prepending the complement of a new character to the left.
+     * Applied along with shift, it keeps the reverse complement up to date in constant time.
+     *
+     * @param rcmer bit sequence of the reverse complement
+     * @param right new right character (of the forward k-mer) in binary-code
+     */
+    static void shift_reverse(kmer_t& rcmer, uint_fast8_t& right);
+
     /**
      * This function constructs the canonical k-mer of a given k-mer.
      *
@@ -92,3 +113,5 @@ class kmer {
 
 
 };
+
+END_KMER
@@ -1,6 +1,8 @@
 #include "kmerAmino.h"
 #include "util.h"
 
+BEGIN_KMER
+
 /**
  * This is the length of a k-mer.
  */
@@ -48,6 +50,18 @@ void kmerAmino::shift_right(kmerAmino_t& kmer, char& chr) {
     kmer &= mask;    // set all bits to zero that exceed the k-mer length
 }
 
+/**
+ * This function shifts a k-mer adding a new character to the right.
+ *
+ * @param kmer bit sequence
+ * @param right right character in binary-code
+ */
+void kmerAmino::shift_right(kmerAmino_t& kmer, uint_fast8_t& right) {
+    kmer <<= 05u;    // shift all current bits to the left by five positions
+    kmer |= right;    // encode the new character within the rightmost five bits
+    kmer &= mask;    // set all bits to zero that exceed the k-mer length
+}
+
 /**
  * This function unshifts a k-mer returning the character on the right.
  *
@@ -73,3 +87,5 @@ string kmerAmino::kmer_to_string(kmerAmino_t& kmer) {
 	}
     return kmer_string;
 }
+
+END_KMER
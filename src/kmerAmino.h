@@ -5,15 +5,30 @@ using namespace std;
 #define maxK 12  // as preprocessor directive
 #endif
 
+#ifndef maxKA    // max. amino acid k-mer length defined
+    #if defined(WIDTHS)    // up to 12 amino acids fit 64 bits, up to 25 fit 128 bits
+        #define maxKA (maxK <= 16 ? 12 : maxK <= 32 ? 25 : maxK)
+    #else
+        #define maxKA maxK
+    #endif
+#endif
+
 #define CLASS_NAME   kmerAmino_t
 #define STORAGE_TYPE uint5K_t
 #define INDEX_TYPE   size5K_t
-#define BIT_LENGTH   (5*maxK)
+#define BIT_LENGTH   (5*maxKA)
 #define LEX_INTEGER_COMPARATORS
+#define INT128_STORAGE
+#include "width.h"
+#if defined(WIDTHS)
+    #define BYTE_NAMESPACE KMER_NAME(maxK)
+#endif
 #include "byte.h"
 
 #include "util.h"
 
+BEGIN_KMER
+
 /**
  * This class contains functions for working with k-mer types.
  */
@@ -56,6 +71,14 @@ class kmerAmino {
      * @param c right character
      */
     static void shift_right(kmerAmino_t& kmer, char& c);
+
+    /**
+     * This function shifts a k-mer adding a new character to the right.
+     *
+     * @param kmer bit sequence
+     * @param right right character in binary-code
+     */
+    static void shift_right(kmerAmino_t& kmer, uint_fast8_t& right);
 	
 	/**
 	* This function unshifts a k-mer returning the character on the right.
@@ -74,3 +97,5 @@ class kmerAmino {
 	static string kmer_to_string(kmerAmino_t& kmer);
 
 };
+
+END_KMER
@@ -1,8 +1,12 @@
 #include "main.h"
 #include <algorithm>
 #include <regex>
-// gzstream imports
-#include "gz/gzstream.h"
+#include "reader.h"
+#include "queue.h"
+
+#include "dispatch.h"
+
+BEGIN_WIDTH
 
 /**
  * This is the entry point of the program.
@@ -106,9 +110,6 @@ int main(int argc, char* argv[]) {
         cout << "                  \t Use 11 for Bacterial, Archaeal, and Plant Plastid Code" << endl;
         cout << "                  \t (See https://www.ncbi.nlm.nih.gov/Taxonomy/Utils/wprintgc.cgi for details.)" << endl;
         cout << endl;
-        cout << "    -M, --maxN    \t Compare number of input genomes to compile paramter DmaxN" << endl;
-        cout << "                  \t Add path/to/makefile (default is makefile in current working directory)." << endl;
-        cout << endl;
         cout << "    -b, --bootstrap \t Perform bootstrapping with the specified number of replicates" << endl;
         cout << "                  \t optional: provide threshold to filter low support splits (e.g. 0.75)" << endl;
         cout << endl;
@@ -127,6 +128,15 @@ int main(int argc, char* argv[]) {
         cout << endl;
         cout << "    -T, --threads \t The number of threads to spawn (default is all)" << endl;
         cout << endl;
+        cout << "    -R, --readers \t The number of additional threads reading, decompressing," << endl;
+        cout << "                  \t and translating input files (default: a quarter of --threads)" << endl;
+        cout << endl;
+        cout << "    -L, --lockfree\t Store the k-mers in lock-free hash tables (scales better to many" << endl;
+        cout << "                  \t threads, but needs more memory)" << endl;
+        cout << endl;
+        cout << "    -P, --prefetch\t The number of k-mers whose slots in the lock-free hash tables are" << endl;
+        cout << "                  \t fetched into the cache ahead of their insertion (default: 16, off: 0)" << endl;
+        cout << endl;
         cout << "    -h, --help    \t Display this help page and quit" << endl;
         cout << endl;
         cout << "  Contact: pangenomics-service@cebitec.uni-bielefeld.de" << endl;
@@ -136,8 +146,6 @@ int main(int argc, char* argv[]) {
 
     // show the help page if no args are given or the arg is --help 
     if (argc <= 1 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0 ) { show_help_page(); return(0);}
-    // show the help page if SANS is run from autoN-script without further arguments or --help
-    if ((strcmp(argv[1],"-M") == 0 ) && (argc <= 3 || strcmp(argv[3], "-h") == 0 || strcmp(argv[3], "--help") == 0 )) { show_help_page(); return(0);}
 
 
     /**
@@ -163,10 +171,6 @@ int main(int argc, char* argv[]) {
     // input
     uint64_t num = 0;    // number of input files
 
-    // automatic recompilation
-    string path = "./makefile"; // path to makefile for automatic recompilation
-    bool check_n = false; // compare num (number of input genomes) to maxN (compile parameter DmaxN)
-
     // kmer args --
     bool userKmer = false; // is k-mer default or custom
     uint64_t kmer = 31;    // length of k-mers
@@ -192,6 +196,8 @@ int main(int argc, char* argv[]) {
 
     // parallel hashing
     uint64_t threads = thread::hardware_concurrency(); // The number of threads to run on (default is #cores including smt / ht)
+    uint64_t readers = 0; // The number of threads reading the input files (default is a quarter of the threads)
+    bool lockfree = false; // Use lock-free hash tables
 
     // bootsrapping
     string consensus_filter; // filter function for filtering after bootstrapping
@@ -433,12 +439,6 @@ int main(int argc, char* argv[]) {
         else if (strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--amino") == 0) {
             amino = true;   // Input provides amino acid sequences
         }
-        else if (strcmp(argv[i], "-M") == 0 || strcmp(argv[i], "--maxN") == 0) {
-            check_n = true; // compare num (number of input genomes) to maxN (compile parameter DmaxN)
-            if (i+1 < argc && argv[i+1][0] != '-'){
-				path = argv[++i]; // path to makefile
-			}
-		}
         else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--code") == 0) {
             if (i+1 < argc) {
                 string param = argv[++i];
@@ -468,6 +468,30 @@ int main(int argc, char* argv[]) {
                 if (!ask_for_user_confirmation()){return 0;}
             }
         }
+        else if (strcmp(argv[i], "-R") == 0 || strcmp(argv[i], "--readers") == 0){
+            catch_missing_dependent_args(argv[i + 1], argv[i]);
+            catch_failed_stoi_cast(argv[i + 1], argv[i]);
+            readers = stoi(argv[++i]); // Number of threads reading the input files
+            if (readers <= 0)
+            {
+                cerr << "Error: reading requires at least one thread" << endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-L") == 0 || strcmp(argv[i], "--lockfree") == 0){
+            lockfree = true; // Use lock-free hash tables
+        }
+        else if (strcmp(argv[i], "-P") == 0 || strcmp(argv[i], "--prefetch") == 0){
+            catch_missing_dependent_args(argv[i + 1], argv[i]);
+            catch_failed_stoi_cast(argv[i + 1], argv[i]);
+            int prefetch = stoi(argv[++i]); // Number of k-mers prefetched ahead of their insertion
+            if (prefetch < 0)
+            {
+                cerr << "Error: the number of prefetched k-mers must not be negative" << endl;
+                return 1;
+            }
+            graph::prefetch = prefetch;
+        }
         // bootsrapping
         else if (strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--bootstrapping") == 0) {
             catch_missing_dependent_args(argv[i + 1], argv[i]);
@@ -609,11 +633,6 @@ int main(int argc, char* argv[]) {
 		cerr << "Error: Blacklist can only be applied when reading sequences as input, i.e. -i or -g." << endl;
 		return 1;
     }
-    if (kmer > maxK && splits.empty()) {
-        cerr << "Error: k-mer length exceeds -DmaxK=" << maxK << endl;
-        cerr << "Solution: Modify -DmaxK in makefile, run make, run SANS." << endl;
-        return 1;
-    }
     if (!newick.empty() && filter != "strict" && filter.find("tree") == -1 && consensus_filter.empty()) {
         cerr << "Error: Newick output only applicable in combination with -f strict or n-tree." << endl;
         return 1;
@@ -684,6 +703,12 @@ int main(int argc, char* argv[]) {
     }
     // deduct default kmer size if not user defined
     if (!userKmer) {kmer = amino == true ? 10 : 31;}
+    uint64_t max_k = amino ? maxKA : maxK;    // max. length of the k-mers in use
+    if (kmer > max_k && splits.empty()) {
+        cerr << "Error: k-mer length exceeds the max. length of the widest k-mers (" << max_k << ")" << endl;
+        cerr << "Solution: add a larger length to KEYS in makefile, run make, run SANS." << endl;
+        return 1;
+    }
 
 
     /**
@@ -1001,21 +1026,15 @@ int main(int argc, char* argv[]) {
      * - Update and check validity of input dependent meta variables
      */ 
 
-    // check if the number of genomes is reasonably close the maximal storable color set
-    if (check_n) {
-       util::check_n(num,path,maxN);
-	}
-
-    // check if the number of genomes exceeds the maximal storable color set
+    // the color width has been chosen at runtime (see dispatch), only the widest one may not suffice
     if (num > maxN) {
-        cerr << "Error: number of input genomes ("<<num<<") exceeds -DmaxN=" << maxN << endl;
-        cerr << "Solution: modify -DmaxN in makefile, run make, run SANS; or use SANS-autoN.sh." << endl;
+        cerr << "Error: number of input genomes ("<<num<<") exceeds the widest color width " << maxN << endl;
+        cerr << "Solution: add a larger width to WIDTHS in makefile, run make, run SANS." << endl;
         return 1;
     }
-    if (maxN-num>=100) {
-		cout << "Warning: number of input genomes ("<<num<<") much lower than -DmaxN=" << maxN << endl;
-		cout << "Recommendation: modify -DmaxN in makefile, run make, run SANS; or use SANS-autoN.sh." << endl;
-	}
+    if (verbose) {
+        cout << "K-mer width: " << (amino ? 5*maxKA : 2*maxK) << " bits, color width: " << maxN << " bits" << endl;
+    }
 
 
     // Set dynamic top by filenum
@@ -1036,7 +1055,11 @@ int main(int argc, char* argv[]) {
     kmer::init(kmer);      // initialize the k-mer length
     kmerAmino::init(kmer); // initialize the k-mer length
     color::init(num);    // initialize the color number
-    graph::init(top, amino, q_table, quality, blacklist, blacklist_amino, threads); // initialize the toplist size and the allowed characters
+    if (readers == 0) {readers = max<uint64_t>(1, threads / 4);}
+    uint64_t queue_size = 2; // number of batches passed from the reading to the hashing threads
+    while (queue_size < 2 * threads) {queue_size *= 2;}
+    uint64_t slots = readers + queue_size + 2 * threads; // max. number of files in progress: read, queued, or hashed (a hashing thread may still cache the previous file)
+    graph::init(top, amino, q_table, quality, blacklist, blacklist_amino, slots, lockfree); // initialize the toplist size and the allowed characters
 
 	
 	/**
@@ -1049,49 +1072,36 @@ int main(int argc, char* argv[]) {
         }
  
         string sequence;    // read in the sequence files and extract the k-mers
-		char c_name[(blacklistfile).length()]; // Create char array for c compatibilty
-		strcpy(c_name, (blacklistfile).c_str()); // Transcire to char array
-
-		igzstream file(c_name, ios::in);    // input file stream
+		reader file(blacklistfile);    // input file reader
 				count::deleteCount();
 
 				string appendixChars; 
-				string line;    // read the file line by line
-				while (getline(file, line)) {
-					if (line.length() > 0) {
-						if (line[0] == '>' || line[0] == '@') {    // FASTA & FASTQ header -> process
-							graph::fill_blacklist(sequence, reverse);
-							sequence.clear();
-						}
-						else if (line[0] == '+') {    // FASTQ quality values -> ignore
-							getline(file, line);
+				file.read([&] () {    // FASTA & FASTQ header -> process
+					graph::fill_blacklist(sequence, reverse);
+					sequence.clear();
+				}, [&] (const char* line, const uint64_t& length) {
+					string newLine(line, length);
+					transform(newLine.begin(), newLine.end(), newLine.begin(), ::toupper);
+					if (shouldTranslate) {
+						if (appendixChars.length() >0 ) {
+							newLine= appendixChars + newLine;
+							appendixChars = "";
 						}
-						else {
-							transform(line.begin(), line.end(), line.begin(), ::toupper);
-							string newLine = line;
-							if (shouldTranslate) {
-								if (appendixChars.length() >0 ) {
-									newLine= appendixChars + newLine;
-									appendixChars = "";
-								}
-								auto toManyChars = line.length() % 3;
-								if (toManyChars > 0) {
-									appendixChars = newLine.substr(line.length() - toManyChars, toManyChars);
-									newLine = newLine.substr(0, line.length() - toManyChars);
-								}
-								newLine = translator::translate(newLine);
-							}
-							sequence += newLine;    // FASTA & FASTQ sequence -> read
+						auto toManyChars = length % 3;
+						if (toManyChars > 0) {
+							appendixChars = newLine.substr(length - toManyChars, toManyChars);
+							newLine = newLine.substr(0, length - toManyChars);
 						}
+						newLine = translator::translate(newLine);
 					}
-				}
+					sequence += newLine;    // FASTA & FASTQ sequence -> read
+				});
 				if (verbose && count::getCount() > 0) {
 					cerr << count::getCount()<< " triplets could not be translated while reading blacklist."<< endl;
 				}
 				graph::fill_blacklist(sequence, reverse);
 				sequence.clear();
 
-				file.close();
        if (verbose) {
             cout << graph::size_blacklist() << " k-mers read." << endl << flush;
         }
@@ -1153,113 +1163,244 @@ int main(int argc, char* argv[]) {
             cout << "Reading input files..." << endl << flush;
         }
 
-        // Thread safe implementation of getting the index of the next input to preocess
-        uint64_t index = 0;
-        std::mutex index_mutex;
-        auto index_lambda = [&] () { std::lock_guard<mutex> lg(index_mutex); return index++;};
-
-        auto lambda = [&] (uint64_t T, vector<uint16_t> genome_ids, vector<uint16_t> file_ids){ // This lambda expression wraps the sequence-kmer hashing
-            string sequence;    // read in the sequence files and extract the k-mers
-            uint64_t i = index_lambda();
-            while (i < genome_ids.size()) {
-				string file_name = gen_files[genome_ids[i]][file_ids[i]]; // the filenames corresponding to the target  
-				if(file_name[0]!='/'){ //no absolute path?
-					file_name=folder+file_name;
-				}
+		vector<uint16_t> genome_ids; //unfold multiple files per genome to two flat lists, one listing the genome ids and one listing the file ids.
+		vector<uint16_t> file_ids;
+		for (int g=0;g<gen_files.size();g++){
+			for (int f=0;f<gen_files[g].size();f++){
+				genome_ids.push_back(g);
+				file_ids.push_back(f);
+			}
+		}
 
-				char c_name[(file_name).length()]; // Create char array for c compatibilty
-				strcpy(c_name, (file_name).c_str()); // Transcire to char array
+        // Input processing is a pipeline: the reading threads open, inflate, parse, and translate the input files, and pass
+        // batches of sequences, or chunks of memory-mapped files, through a bounded queue to the hashing threads. Each file
+        // occupies a slot of the coverage filter, such that k-mers are counted per file, until its last batch is hashed.
+        struct task {
+            uint64_t i;    // index of the input file
+            uint64_t slot;    // coverage filter slot
+            reader* file;
+            uint64_t batches;    // number of batches passed to the hashing threads
+            uint64_t done;    // number of batches hashed
+            uint64_t holders;    // number of hashing threads caching k-mer occurrences of the file
+            bool read;    // all batches are passed
+        };
+        struct batch {
+            task* source;
+            bool mapped;    // a chunk of a memory-mapped file
+            uint64_t begin;    // begin of the chunk
+            uint64_t end;    // end of the chunk
+            string sequence;    // sequence read by a reading thread
+            vector<uint64_t> records;    // positions in the sequence where a new record starts
+        };
+        bounded_queue<batch*> queue(queue_size);
+        vector<uint64_t> free_slots;    // unused coverage filter slots
+        for (uint64_t slot = slots; slot > 0; --slot) {free_slots.push_back(slot-1);}
+        uint64_t index = 0;
+        atomic<uint64_t> reading(readers);    // number of reading threads still running
+        std::mutex task_mutex;
+
+        bool direct = window == 1 && iupac == 1 && !shouldTranslate;    // hash the k-mers directly from the lines
+        uint64_t batch_size = 1 << 20;    // sequence length per batch
+
+        auto push = [&] (batch* next) {
+            next->source->batches++;
+            queue.push(next);    // waits while the queue is full
+        };
+
+        auto release = [&] (task* current) {    // the last batch of the file is hashed
+            graph::clear_thread(current->slot);
+            delete current->file;
+            std::lock_guard<mutex> lg(task_mutex);
+            free_slots.push_back(current->slot);
+            delete current;
+        };
+
+        auto read_lambda = [&] (uint64_t thread_id){ // This lambda expression wraps the reading of the input files
+            while (true) {
+                task* current;
+                {
+                    std::lock_guard<mutex> lg(task_mutex);
+                    if (index == genome_ids.size()) break;
+                    current = new task{index++, free_slots.back(), nullptr, 0, 0, 0, false};
+                    free_slots.pop_back();
+                }
+                uint64_t i = current->i;
 
-				igzstream file(c_name, ios::in);    // input file stream
-				if (verbose) {     // print progress
-// 					cout << "\33[2K\r" << file_name;
-					if (q_table.size()>0) {
-						cout <<" q="<<q_table[genome_ids[i]];
-					}
-					cout << " (genome " << genome_ids[i]+1 << "/" << denom_file_count;
-					if(genome_ids.size()>gen_files.size()){
-						cout << "; file " << i+1 << "/" << genome_ids.size();
-					}
-					cout << ")" << endl;
-				}
-				count::deleteCount();
+                string file_name = gen_files[genome_ids[i]][file_ids[i]]; // the filenames corresponding to the target
+                if(file_name[0]!='/'){ //no absolute path?
+                    file_name=folder+file_name;
+                }
+                current->file = new reader(file_name);    // input file reader
+                if (verbose) {     // print progress
+                    // cout << "\33[2K\r" << file_name;
+                    if (q_table.size()>0) {
+                        cout <<" q="<<q_table[genome_ids[i]];
+                    }
+                    cout << " (genome " << genome_ids[i]+1 << "/" << denom_file_count;
+                    if(genome_ids.size()>gen_files.size()){
+                        cout << "; file " << i+1 << "/" << genome_ids.size();
+                    }
+                    cout << ")" << endl;
+                }
+                count::deleteCount();
 
-				string appendixChars; 
-				string line;    // read the file line by line
-				while (getline(file, line)) {
-					if (line.length() > 0) {
-						if (line[0] == '>' || line[0] == '@') {    // FASTA & FASTQ header -> process
-							if (window > 1) {
-								iupac > 1 ? graph::add_minimizers(T, sequence, genome_ids[i], reverse, window, iupac)
-										: graph::add_minimizers(T, sequence, genome_ids[i], reverse, window);
-							} else {
-								iupac > 1 ? graph::add_kmers(T, sequence, genome_ids[i], reverse, iupac)
-										: graph::add_kmers(T, sequence, genome_ids[i], reverse);
-							}
+                if (current->file->mapped() && !shouldTranslate) {    // the hashing threads read the chunks themselves
+                    vector<uint64_t> bounds = current->file->split(reader::chunk_size, !direct);    // minimizers and IUPAC codes need whole records
+                    for (uint64_t chunk = 0; chunk+1 < bounds.size(); ++chunk) {
+                        push(new batch{current, true, bounds[chunk], bounds[chunk+1]});
+                    }
+                } else {    // collect batches of whole records, or with the last k-1 characters of the previous batch
+                    batch* next = new batch{current, false};
+                    uint64_t length = 0;    // length of the current record
+                    string appendixChars;
+                    current->file->read([&] () {    // FASTA & FASTQ header -> start a new record
+                        if (!direct && next->sequence.size() >= batch_size) {
+                            push(next);
+                            next = new batch{current, false};
+                        }
+                        next->records.push_back(next->sequence.size());
+                        length = 0;
+                    }, [&] (const char* line, const uint64_t& size) {    // FASTA & FASTQ sequence -> read
+                        if (direct) {
+                            next->sequence.append(line, size);
+                            length += size;
+                            if (next->sequence.size() >= batch_size) {    // the k-mers ending in the next batch start here
+                                batch* full = next;
+                                next = new batch{current, false};
+                                next->sequence.assign(full->sequence, full->sequence.size() - min<uint64_t>(length, kmer-1), string::npos);
+                                push(full);
+                            }
+                            return;
+                        }
+                        string newLine(line, size);
+                        transform(newLine.begin(), newLine.end(), newLine.begin(), ::toupper);
+                        if (shouldTranslate) {
+                            if (appendixChars.length() >0 ) {
+                                newLine= appendixChars + newLine;
+                                appendixChars = "";
+                            }
+                            auto toManyChars = size % 3;
+                            if (toManyChars > 0) {
+                                appendixChars = newLine.substr(size - toManyChars, toManyChars);
+                                newLine = newLine.substr(0, size - toManyChars);
+                            }
+
+                            newLine = translator::translate(newLine);
+                        }
+                        next->sequence += newLine;
+                    });
+                    push(next);
+                }
+                if (verbose && count::getCount() > 0) {
+                    cerr << count::getCount()<< " triplets could not be translated."<< endl;
+                }
 
-							sequence.clear();
+                bool finished;
+                {
+                    std::lock_guard<mutex> lg(task_mutex);
+                    current->read = true;
+                    finished = current->done == current->batches && current->holders == 0;
+                }
+                if (finished) {release(current);}
+            }
+            if (--reading == 0) {queue.close();}    // no more batches to come
+        }; // End of lambda expression
 
-//                            if (verbose) {
-//                                cout << "\33[2K\r" << line << flush << endl;    // print progress
-//                            }
-						}
-						else if (line[0] == '+') {    // FASTQ quality values -> ignore
-							getline(file, line);
-						}
-						else {
-							transform(line.begin(), line.end(), line.begin(), ::toupper);
-							string newLine = line;
-							if (shouldTranslate) {
-								if (appendixChars.length() >0 ) {
-									newLine= appendixChars + newLine;
-									appendixChars = "";
-								}
-								auto toManyChars = line.length() % 3;
-								if (toManyChars > 0) {
-									appendixChars = newLine.substr(line.length() - toManyChars, toManyChars);
-									newLine = newLine.substr(0, line.length() - toManyChars);
-								}
+        auto lambda = [&] (uint64_t thread_id){ // This lambda expression wraps the sequence-kmer hashing
+            string sequence;    // read in the sequence files and extract the k-mers
+            batch* next;
+            task* cached = nullptr;    // the file whose k-mer occurrences are cached by this thread
+            auto uncache = [&] () {    // pass the cached occurrences to the coverage filter of the file
+                if (!cached) return;
+                graph::flush_cache();
+                bool finished;
+                {
+                    std::lock_guard<mutex> lg(task_mutex);
+                    cached->holders--;
+                    finished = cached->read && cached->done == cached->batches && cached->holders == 0;
+                }
+                if (finished) {release(cached);}
+                cached = nullptr;
+            };
+            while (true) {
+                if (!queue.try_pop(next)) {
+                    uncache();    // pass on the cached occurrences before waiting
+                    if (!queue.pop(next)) {    // no more batches to come
+                        graph::flush();    // insert the buffered k-mers of this thread
+                        return;
+                    }
+                }
+                task* current = next->source;
+                uint64_t i = current->i;
+                uint64_t T = current->slot;
+                if (current != cached) {
+                    uncache();
+                    std::lock_guard<mutex> lg(task_mutex);
+                    current->holders++;
+                    cached = current;
+                }
 
-								newLine = translator::translate(newLine);
-							}
-							sequence += newLine;    // FASTA & FASTQ sequence -> read
-						}
-					}
-				}
-				if (verbose && count::getCount() > 0) {
-					cerr << count::getCount()<< " triplets could not be translated."<< endl;
-				}
-				if (window > 1) {
-					iupac > 1 ? graph::add_minimizers(T, sequence, genome_ids[i], reverse, window, iupac)
-							: graph::add_minimizers(T, sequence, genome_ids[i], reverse, window);
-				} else {
-					iupac > 1 ? graph::add_kmers(T, sequence, genome_ids[i], reverse, iupac)
-							: graph::add_kmers(T, sequence, genome_ids[i], reverse);
-				}
-				sequence.clear();
+                auto process = [&] () {
+                    if (window > 1) {
+                        iupac > 1 ? graph::add_minimizers(T, sequence, genome_ids[i], reverse, window, iupac)
+                                : graph::add_minimizers(T, sequence, genome_ids[i], reverse, window);
+                    } else {
+                        iupac > 1 ? graph::add_kmers(T, sequence, genome_ids[i], reverse, iupac)
+                                : graph::add_kmers(T, sequence, genome_ids[i], reverse);
+                    }
+                    sequence.clear();
+                };
+
+                if (next->mapped && direct) {    // hash the k-mers directly from the lines
+                    kmer_state state;
+                    graph::reset(state);
+                    current->file->read(next->begin, next->end, kmer-1, [&] () {    // FASTA & FASTQ header -> start a new sequence
+                        graph::reset(state);
+                    }, [&] (const char* line, const uint64_t& length) {    // FASTA & FASTQ sequence -> read
+                        graph::add_kmers(T, line, length, state, genome_ids[i], reverse);
+                    });
+                } else if (next->mapped) {    // collect the whole sequence first
+                    current->file->read(next->begin, next->end, 0, [&] () {    // FASTA & FASTQ header -> process
+                        process();
+                    }, [&] (const char* line, const uint64_t& length) {
+                        string newLine(line, length);
+                        transform(newLine.begin(), newLine.end(), newLine.begin(), ::toupper);
+                        sequence += newLine;    // FASTA & FASTQ sequence -> read
+                    });
+                    process();
+                } else {    // hash the records of the batch (the first part may continue a record of the previous batch)
+                    next->records.push_back(next->sequence.size());
+                    kmer_state state;
+                    uint64_t begin = 0;
+                    for (uint64_t end : next->records) {
+                        if (direct) {
+                            graph::reset(state);
+                            graph::add_kmers(T, next->sequence.data() + begin, end - begin, state, genome_ids[i], reverse);
+                        } else if (end > begin) {
+                            sequence.assign(next->sequence, begin, end - begin);
+                            process();
+                        }
+                        begin = end;
+                    }
+                }
+                delete next;
 
-				
-// 				if (verbose) {
-// 					cout << "\33[2K\r" << flush;
-// 				}
-				file.close();
-                graph::clear_thread(T);
-                i = index_lambda();
+                bool finished;
+                {
+                    std::lock_guard<mutex> lg(task_mutex);
+                    current->done++;
+                    finished = current->read && current->done == current->batches && current->holders == 0;
+                }
+                if (finished) {release(current);}
             }
         }; // End of lambda expression
 
-        // Driver code for multithreaded kmer hashing
-		vector<uint16_t> genome_ids; //unfold multiple files per genome to two flat lists, one listing the genome ids and one listing the file ids.
-		vector<uint16_t> file_ids;
-		for (int g=0;g<gen_files.size();g++){
-			for (int f=0;f<gen_files[g].size();f++){
-				genome_ids.push_back(g);
-				file_ids.push_back(f);
-			}
-		}
-		vector<thread> thread_holder(threads);
-        for (uint64_t thread_id = 0; thread_id < threads; ++thread_id){thread_holder[thread_id] = thread(lambda, thread_id, genome_ids, file_ids);}
-        for (uint64_t thread_id = 0; thread_id < threads; ++thread_id){thread_holder[thread_id].join();}
+        // Driver code for the reading and multithreaded kmer hashing
+		reader::threads = max<uint64_t>(1, threads / max<uint64_t>(1, min<uint64_t>(readers, genome_ids.size()))); // each reading thread gets some helpers for inflating compressed files
+		vector<thread> thread_holder(readers + threads);
+        for (uint64_t thread_id = 0; thread_id < readers; ++thread_id){thread_holder[thread_id] = thread(read_lambda, thread_id);}
+        for (uint64_t thread_id = readers; thread_id < readers + threads; ++thread_id){thread_holder[thread_id] = thread(lambda, thread_id);}
+        for (uint64_t thread_id = 0; thread_id < readers + threads; ++thread_id){thread_holder[thread_id].join();}
         
 
     }
@@ -1300,6 +1441,7 @@ double min_value = numeric_limits<double>::min(); // current minimal weight repr
 				}
 			}
 		}
+		graph::flush();    // add the singleton counts of the unitig k-mers
 		if (verbose) {
 			end = chrono::high_resolution_clock::now(); 
 			cout<< "\33[2K\r" << "Processed " << max << " unitigs (100%)" << " (" << util::format_time(end - begin) << ")" << endl << flush;
@@ -1309,6 +1451,7 @@ double min_value = numeric_limits<double>::min(); // current minimal weight repr
 
 
 #endif
+       graph::compact(threads); // merge the lock-free hash tables, if used
        if(splits.empty() && (graph::number_singleton_kmers()+graph::number_kmers()==0)){
 		cout << "no k-mers found." << endl;
 	       exit(0);
@@ -1376,7 +1519,7 @@ double min_value = numeric_limits<double>::min(); // current minimal weight repr
 		if (verbose) {
 			cout << "Accumulating splits from non-singleton k-mers..."  << flush;
 		}
-		graph::add_weights(mean, min_value, verbose);  // accumulate split weights
+		graph::add_weights(mean, min_value, verbose, threads);  // accumulate split weights
 		if (verbose) {
 			end = chrono::high_resolution_clock::now();
 			cout << "\33[2K\r" << "Accumulating splits from non-singleton k-mers... (" << util::format_time(end - begin) << ")" << endl;
@@ -1734,3 +1877,10 @@ void apply_filter(string filter, string newick, std::function<string(const uint6
 		}	
 
 }
+
+/**
+ * This registers the entry point of this k-mer and color width (see dispatch).
+ */
+static dispatch::width registered(maxK, maxKA, maxN, main);
+
+END_WIDTH
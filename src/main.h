@@ -29,6 +29,8 @@ using namespace std;
 // phylogenomics with Abundance-filter, Multi-threading and Bootstrapping on Amino-acid or GEnomic Sequences
 #define SANS_VERSION "2.4_10A"    // SANS ambages
 
+BEGIN_WIDTH
+
 /**
  * This is the entry point of the program.
  *
@@ -51,3 +53,5 @@ int main(int argc, char* argv[]);
  */
 void apply_filter(string filter, string newick, std::function<string(const uint64_t&)> map, multimap_<double, color_t>& split_list, bool verbose);
 void apply_filter(string filter, string newick, std::function<string(const uint64_t&)> map, multimap_<double, color_t>& split_list, hash_map<color_t, uint32_t>* support_values, const uint32_t& bootstrap_no, bool verbose);
+
+END_WIDTH
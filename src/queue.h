@@ -0,0 +1,207 @@
+#ifndef SANS_QUEUE_H
+#define SANS_QUEUE_H
+
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+
+
+using namespace std;
+
+/**
+ * This class is a bounded lock-free multi-producer multi-consumer queue.
+ * Each cell carries a sequence number telling whether it is ready to be written or read.
+ * source: https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ * Threads that find the queue full or empty sleep on a condition variable instead of spinning.
+ */
+template <typename T>
+class bounded_queue {
+
+private:
+
+    /**
+     * This is a cell of the ring buffer.
+     */
+    struct cell {
+        atomic<uint64_t> sequence;
+        T data;
+    };
+
+    /**
+     * This is the ring buffer, its size is a power of two.
+     */
+    vector<cell> buffer;
+    uint64_t mask;
+
+    /**
+     * These are the positions of the next push and pop, on separate cache lines.
+     */
+    alignas(64) atomic<uint64_t> push_pos;
+    alignas(64) atomic<uint64_t> pop_pos;
+
+    /**
+     * These are signalled when an element has been appended or removed, or the queue has been closed.
+     */
+    mutex wait_mutex;
+    condition_variable not_full;
+    condition_variable not_empty;
+    bool closed;
+
+    /**
+     * This function appends an element, unless the queue is full, without waking up a waiting thread.
+     *
+     * @param data element
+     * @return true, if the element has been appended
+     */
+    bool claim_push(const T& data) {
+        uint64_t pos = push_pos.load(memory_order_relaxed);
+        while (true) {
+            cell& next = buffer[pos & mask];
+            uint64_t sequence = next.sequence.load(memory_order_acquire);
+            int64_t diff = (int64_t) sequence - (int64_t) pos;
+            if (diff == 0) {    // free cell, claim it
+                if (push_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    next.data = data;
+                    next.sequence.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {    // full
+                return false;
+            }
+            else {    // another thread was faster
+                pos = push_pos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * This function removes the first element, unless the queue is empty, without waking up a waiting thread.
+     *
+     * @param data element
+     * @return true, if an element has been removed
+     */
+    bool claim_pop(T& data) {
+        uint64_t pos = pop_pos.load(memory_order_relaxed);
+        while (true) {
+            cell& next = buffer[pos & mask];
+            uint64_t sequence = next.sequence.load(memory_order_acquire);
+            int64_t diff = (int64_t) sequence - (int64_t) (pos + 1);
+            if (diff == 0) {    // filled cell, claim it
+                if (pop_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    data = next.data;
+                    next.sequence.store(pos + mask + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {    // empty
+                return false;
+            }
+            else {    // another thread was faster
+                pos = pop_pos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * This function wakes up a waiting thread.
+     * The mutex is taken, such that a thread about to wait cannot miss the signal.
+     *
+     * @param waiting condition variable
+     */
+    void signal(condition_variable& waiting) {
+        {
+            lock_guard<mutex> lock(wait_mutex);
+        }
+        waiting.notify_one();
+    }
+
+public:
+
+    /**
+     * This function creates an empty queue.
+     *
+     * @param capacity min. number of elements (rounded up to a power of two)
+     */
+    bounded_queue(uint64_t capacity) {
+        uint64_t size = 2;
+        while (size < capacity) size *= 2;
+        buffer = vector<cell>(size);
+        mask = size - 1;
+        for (uint64_t i = 0; i < size; ++i) {
+            buffer[i].sequence.store(i, memory_order_relaxed);
+        }
+        push_pos.store(0, memory_order_relaxed);
+        pop_pos.store(0, memory_order_relaxed);
+        closed = false;
+    }
+
+    /**
+     * This function appends an element, unless the queue is full.
+     *
+     * @param data element
+     * @return true, if the element has been appended
+     */
+    bool try_push(const T& data) {
+        if (!claim_push(data)) return false;
+        signal(not_empty);
+        return true;
+    }
+
+    /**
+     * This function appends an element, waiting while the queue is full.
+     *
+     * @param data element
+     */
+    void push(const T& data) {
+        if (try_push(data)) return;
+        unique_lock<mutex> lock(wait_mutex);
+        not_full.wait(lock, [&] {return claim_push(data);});
+        not_empty.notify_one();
+    }
+
+    /**
+     * This function removes the first element, unless the queue is empty.
+     *
+     * @param data element
+     * @return true, if an element has been removed
+     */
+    bool try_pop(T& data) {
+        if (!claim_pop(data)) return false;
+        signal(not_full);
+        return true;
+    }
+
+    /**
+     * This function removes the first element, waiting while the queue is empty and open.
+     *
+     * @param data element
+     * @return true, if an element has been removed, false if the queue is empty and closed
+     */
+    bool pop(T& data) {
+        if (try_pop(data)) return true;
+        unique_lock<mutex> lock(wait_mutex);
+        bool popped = false;
+        not_empty.wait(lock, [&] {return (popped = claim_pop(data)) || closed;});
+        if (popped) not_full.notify_one();
+        return popped;
+    }
+
+    /**
+     * This function closes the queue, i.e. no more elements will be appended.
+     * Threads waiting for an element return once the queue is empty.
+     */
+    void close() {
+        {
+            lock_guard<mutex> lock(wait_mutex);
+            closed = true;
+        }
+        not_empty.notify_all();
+    }
+
+};
+
+#endif
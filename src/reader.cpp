@@ -0,0 +1,439 @@
+#include "reader.h"
+#include <cstring>
+#include <climits>
+#include <thread>
+#include <future>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+
+/**
+ * This is the number of threads inflating the members of a BGZF or multi-member gzip file.
+ */
+uint64_t reader::threads = 1;
+
+/**
+ * This is the size of the chunks of a memory-mapped file that are processed concurrently.
+ */
+const uint64_t reader::chunk_size;
+
+/**
+ * This function reads a little-endian integer of the given number of bytes.
+ */
+static inline uint64_t little_endian(const unsigned char* pos, const uint64_t& bytes) {
+    uint64_t value = 0;
+    for (uint64_t i = 0; i < bytes; ++i) {
+        value |= (uint64_t) pos[i] << (8*i);
+    }
+    return value;
+}
+
+/**
+ * This function checks if a gzip header (deflate, no reserved flags) starts at the given position.
+ */
+static inline bool is_gzip(const unsigned char* pos) {
+    return pos[0] == 0x1f && pos[1] == 0x8b && pos[2] == 8 && (pos[3] & 0xe0) == 0;
+}
+
+/**
+ * This function opens a file, memory-mapped if possible, otherwise via zlib.
+ *
+ * @param file_name name of the file
+ */
+reader::reader(const string& file_name) : file_name(file_name), map(nullptr), map_size(0), compressed(false), gz_file(nullptr), skip_quality(false) {
+#if !defined(_WIN32)
+    int file = open(file_name.c_str(), O_RDONLY);
+    if (file < 0) return;
+    struct stat info;
+    // regular files are mapped, everything else (pipes, empty files) goes through zlib
+    if (fstat(file, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED) {
+            map = (char*) data;
+            map_size = info.st_size;
+            compressed = map_size >= 2 && (unsigned char) map[0] == 0x1f && (unsigned char) map[1] == 0x8b;
+            madvise(map, map_size, MADV_SEQUENTIAL);
+            close(file);
+            return;
+        }
+    }
+    close(file);
+#endif
+    gz_file = gzopen(file_name.c_str(), "rb");
+    if (gz_file != nullptr) {
+        gzbuffer(gz_file, 1u << 17);    // let zlib fetch large chunks of compressed data
+    }
+}
+
+/**
+ * This function releases the mapping or the zlib handle.
+ */
+reader::~reader() {
+#if !defined(_WIN32)
+    if (map != nullptr) munmap(map, map_size);
+#endif
+    if (gz_file != nullptr) gzclose(gz_file);
+}
+
+/**
+ * This function tells whether the file could be opened.
+ *
+ * @return true, if the file is readable
+ */
+bool reader::good() {
+    return map != nullptr || gz_file != nullptr;
+}
+
+/**
+ * This function tells whether the file is memory-mapped and not compressed, i.e., it can be split into chunks.
+ *
+ * @return true, if chunks of the file can be read concurrently
+ */
+bool reader::mapped() {
+    return map != nullptr && !compressed;
+}
+
+/**
+ * This function reads the whole file and hands out headers and sequence lines.
+ * FASTQ quality lines are skipped, empty lines are ignored.
+ *
+ * @param record function called at each FASTA/FASTQ header
+ * @param sequence function called for each sequence line (not upper-cased, without newline)
+ */
+void reader::read(const function<void()>& record, const function<void(const char*, const uint64_t&)>& sequence) {
+    skip_quality = false;
+    carry.clear();
+    if (map != nullptr && !compressed) {    // the whole file is one block
+        parse(map, map + map_size, true, skip_quality, record, sequence);
+        return;
+    }
+
+    if (map != nullptr) {    // inflate batches of gzip members in parallel, while parsing the previous batch
+        batch batches[2];
+        uint64_t offset = 0;
+        uint64_t current = 0;
+        if (collect(offset, batches[current]) > 0) {
+            future<void> job = async(launch::async, [&, current] { inflate_batch(batches[current]); });
+            while (true) {
+                job.get();
+                batch& done = batches[current];
+                bool failed = done.valid < done.members.size();
+                if (failed) {    // not a member boundary after all, continue in one stream
+                    offset = done.members[done.valid].begin;
+                }
+                else if (collect(offset, batches[1-current]) > 0) {
+                    job = async(launch::async, [&, current] { inflate_batch(batches[1-current]); });
+                    feed(done.data.data(), done.data.data() + done.offsets[done.valid], record, sequence);
+                    current = 1-current;
+                    continue;
+                }
+                feed(done.data.data(), done.data.data() + done.offsets[done.valid], record, sequence);
+                break;
+            }
+        }
+        if (offset < map_size) {    // single or large members
+            inflate_stream(offset, record, sequence);
+        }
+    }
+    else if (gz_file != nullptr) {
+        vector<char> block(block_size);
+        while (true) {
+            int num = gzread(gz_file, block.data(), block.size());
+            if (num < 0) {
+                cerr << "Error: could not decompress file: " << file_name << endl;
+                exit(1);
+            }
+            if (num == 0) break;    // end of file
+            feed(block.data(), block.data() + num, record, sequence);
+        }
+    }
+    parse(carry.data(), carry.data() + carry.size(), true, skip_quality, record, sequence);    // last line without newline
+    carry.clear();
+}
+
+/**
+ * This function splits a memory-mapped plain file into chunks of whole lines.
+ * FASTQ files, or if requested also FASTA files, are split at record headers only.
+ * Other files form a single chunk.
+ *
+ * @param size min. size of a chunk
+ * @param records true, if each chunk has to start with a record header
+ * @return chunk boundaries (first and last are the file's begin and end)
+ */
+vector<uint64_t> reader::split(const uint64_t& size, const bool& records) {
+    vector<uint64_t> bounds(1, 0);
+    if (map != nullptr && !compressed) {
+        const char* end = map + map_size;
+        auto next_line = [&] (const char* pos) {    // begin of the next line, or the end of the file
+            const char* eol = (const char*) memchr(pos, '\n', end - pos);
+            return eol == nullptr ? end : eol + 1;
+        };
+        bool fastq = map[0] == '@';
+        while (map_size - bounds.back() > size) {
+            const char* line = next_line(map + bounds.back() + size - 1);
+            while (line < end) {
+                if (fastq) {    // a header is followed by the sequence and the separator (quality values may start with @, too)
+                    const char* separator = next_line(next_line(line));
+                    if (*line == '@' && separator < end && *separator == '+') break;
+                }
+                else if (!records || *line == '>') break;
+                line = next_line(line);
+            }
+            if (line == end) break;
+            bounds.push_back(line - map);
+        }
+    }
+    bounds.push_back(map_size);
+    return bounds;
+}
+
+/**
+ * This function reads the lines of one chunk and hands out headers and sequence lines.
+ * If the chunk ends within a sequence, the sequence is continued for the given number of characters,
+ * such that all k-mers starting in the chunk are complete. Files that are not memory-mapped are read as a whole.
+ *
+ * @param begin begin of the chunk
+ * @param end end of the chunk
+ * @param overlap number of sequence characters to read beyond the chunk (i.e., k-1)
+ * @param record function called at each FASTA/FASTQ header
+ * @param sequence function called for each sequence line (not upper-cased, without newline)
+ */
+void reader::read(const uint64_t& begin, const uint64_t& end, const uint64_t& overlap, const function<void()>& record, const function<void(const char*, const uint64_t&)>& sequence) {
+    if (map == nullptr || compressed) {
+        read(record, sequence);
+        return;
+    }
+    bool skip_quality = false;    // chunks start with a record, and several threads may read chunks of the file
+    parse(map + begin, map + end, end == map_size, skip_quality, record, sequence);
+
+    uint64_t rest = overlap;
+    const char* pos = map + end;
+    while (rest > 0 && pos < map + map_size) {
+        const char* eol = (const char*) memchr(pos, '\n', map + map_size - pos);
+        if (eol == nullptr) eol = map + map_size;
+        uint64_t length = min<uint64_t>(eol - pos, rest);
+        if (length > 0) {
+            if (*pos == '>' || *pos == '@' || *pos == '+') break;    // the sequence has ended
+            sequence(pos, length);
+            rest -= length;
+        }
+        pos = eol + 1;
+    }
+}
+
+/**
+ * This function parses the next block of the file, continuing an incomplete line of the previous block.
+ *
+ * @param begin first character of the block
+ * @param end end of the block
+ * @param record function called at each FASTA/FASTQ header
+ * @param sequence function called for each sequence line
+ */
+void reader::feed(const char* begin, const char* end, const function<void()>& record, const function<void(const char*, const uint64_t&)>& sequence) {
+    if (!carry.empty()) {    // complete the line of the previous block first
+        const char* eol = (const char*) memchr(begin, '\n', end - begin);
+        if (eol == nullptr) {
+            carry.append(begin, end);
+            return;
+        }
+        carry.append(begin, eol + 1);
+        parse(carry.data(), carry.data() + carry.size(), false, skip_quality, record, sequence);
+        carry.clear();
+        begin = eol + 1;
+    }
+    uint64_t used = parse(begin, end, false, skip_quality, record, sequence);
+    carry.assign(begin + used, end);
+}
+
+/**
+ * This function determines the gzip member starting at the given position of the mapped file.
+ * BGZF blocks state their size, otherwise the member ends where the next gzip header is found.
+ *
+ * @param offset position in the compressed file
+ * @param next the member
+ * @return true, if the member is small enough to be inflated as a whole
+ */
+bool reader::next_member(const uint64_t& offset, member& next) {
+    const unsigned char* data = (const unsigned char*) map;
+    if (offset + 18 > map_size || !is_gzip(data + offset)) return false;
+
+    next.begin = offset;
+    const unsigned char* header = data + offset;
+    if ((header[3] & 4) && little_endian(header+10, 2) >= 6 && header[12] == 'B' && header[13] == 'C' && little_endian(header+14, 2) == 2) {
+        next.end = offset + little_endian(header+16, 2) + 1;    // BGZF block size
+    }
+    else {    // search the next header, a false hit is detected when inflating
+        const unsigned char* limit = data + min(map_size, offset + member_limit);
+        const unsigned char* pos = header + 18;
+        next.end = 0;
+        while (pos < limit) {
+            pos = (const unsigned char*) memchr(pos, 0x1f, limit - pos);
+            if (pos == nullptr) break;
+            if (pos + 4 <= data + map_size && is_gzip(pos)) {
+                next.end = pos - data;
+                break;
+            }
+            ++pos;
+        }
+        if (next.end == 0) {
+            if (limit != data + map_size) return false;    // large member
+            next.end = map_size;
+        }
+    }
+    if (next.end > map_size || next.end - next.begin < 18) return false;
+    next.size = little_endian(data + next.end - 4, 4);    // inflated size (mod 2^32)
+    return next.size <= 4 * member_limit;
+}
+
+/**
+ * This function collects consecutive gzip members for one batch.
+ *
+ * @param offset position of the first member, updated to the end of the batch
+ * @param next the batch
+ * @return number of members
+ */
+uint64_t reader::collect(uint64_t& offset, batch& next) {
+    next.members.clear();
+    next.offsets.assign(1, 0);
+    member current;
+    while (next.offsets.back() < threads * batch_size && next_member(offset, current)) {
+        next.members.push_back(current);
+        next.offsets.push_back(next.offsets.back() + current.size);
+        offset = current.end;
+    }
+    if (next.members.size() == 1 && offset == map_size) {    // single member, better streamed
+        offset = next.members[0].begin;
+        next.members.clear();
+    }
+    return next.members.size();
+}
+
+/**
+ * This function inflates all members of a batch using several threads.
+ *
+ * @param current the batch
+ */
+void reader::inflate_batch(batch& current) {
+    uint64_t count = current.members.size();
+    current.data.resize(current.offsets[count] + 1);    // non-empty, zlib needs an output pointer
+    vector<char> correct(count, 0);
+
+    // each thread inflates a range of members of about the same inflated size
+    auto inflate_range = [&](uint64_t from, uint64_t to) {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, 15+16) != Z_OK) return;
+        for (uint64_t i = from; i < to; ++i) {
+            const member& next = current.members[i];
+            inflateReset(&stream);
+            stream.next_in = (unsigned char*) map + next.begin;
+            stream.avail_in = next.end - next.begin;
+            stream.next_out = (unsigned char*) current.data.data() + current.offsets[i];
+            stream.avail_out = next.size;
+            int ret = inflate(&stream, Z_FINISH);
+            correct[i] = ret == Z_STREAM_END && stream.avail_in == 0 && stream.avail_out == 0;
+            if (!correct[i]) break;
+        }
+        inflateEnd(&stream);
+    };
+    uint64_t parts = min(threads, count);
+    vector<uint64_t> bounds(parts+1, count);
+    for (uint64_t part = 0, i = 0; part < parts; ++part) {
+        while (i < count && current.offsets[i] < part * current.offsets[count] / parts) ++i;
+        bounds[part] = i;
+    }
+    vector<thread> helpers;
+    for (uint64_t part = 1; part < parts; ++part) {
+        helpers.emplace_back(inflate_range, bounds[part], bounds[part+1]);
+    }
+    inflate_range(bounds[0], bounds[1]);
+    for (thread& helper: helpers) helper.join();
+
+    current.valid = 0;
+    while (current.valid < count && correct[current.valid]) ++current.valid;
+}
+
+/**
+ * This function inflates the mapped file from the given position on in one stream.
+ *
+ * @param offset position in the compressed file
+ * @param record function called at each FASTA/FASTQ header
+ * @param sequence function called for each sequence line
+ */
+void reader::inflate_stream(const uint64_t& offset, const function<void()>& record, const function<void(const char*, const uint64_t&)>& sequence) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 15+32) != Z_OK) {
+        cerr << "Error: could not decompress file: " << file_name << endl;
+        exit(1);
+    }
+    vector<char> block(block_size);
+    const unsigned char* pos = (const unsigned char*) map + offset;
+    const unsigned char* end = (const unsigned char*) map + map_size;
+    while (true) {
+        stream.next_in = (unsigned char*) pos;
+        stream.avail_in = min<uint64_t>(end - pos, UINT_MAX);
+        stream.next_out = (unsigned char*) block.data();
+        stream.avail_out = block.size();
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        pos = stream.next_in;
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            cerr << "Error: could not decompress file: " << file_name << endl;
+            exit(1);
+        }
+        feed(block.data(), (char*) stream.next_out, record, sequence);
+        if (ret == Z_STREAM_END) {
+            if (end - pos < 4 || !is_gzip(pos)) break;    // trailing garbage is ignored, as by gzread
+            inflateReset(&stream);
+        }
+        else if (ret == Z_BUF_ERROR && pos == end) {    // truncated file
+            cerr << "Error: could not decompress file: " << file_name << endl;
+            exit(1);
+        }
+    }
+    inflateEnd(&stream);
+}
+
+/**
+ * This function parses all complete lines of a block.
+ *
+ * @param begin first character of the block
+ * @param end end of the block
+ * @param last true, if the block ends with the file (the last line may lack a newline)
+ * @param skip_quality true, if the next line holds FASTQ quality values
+ * @param record function called at each FASTA/FASTQ header
+ * @param sequence function called for each sequence line
+ * @return number of characters consumed
+ */
+uint64_t reader::parse(const char* begin, const char* end, bool last, bool& skip_quality, const function<void()>& record, const function<void(const char*, const uint64_t&)>& sequence) {
+    const char* pos = begin;
+    while (pos < end) {
+        const char* eol = (const char*) memchr(pos, '\n', end - pos);
+        if (eol == nullptr) {
+            if (!last) break;    // incomplete line, wait for the next block
+            eol = end;
+        }
+        uint64_t length = eol - pos;
+        if (skip_quality) {    // FASTQ quality values -> ignore
+            skip_quality = false;
+        }
+        else if (length > 0) {
+            if (*pos == '>' || *pos == '@') {    // FASTA & FASTQ header -> process
+                record();
+            }
+            else if (*pos == '+') {    // FASTQ separator, quality values follow
+                skip_quality = true;
+            }
+            else {    // FASTA & FASTQ sequence -> read
+                sequence(pos, length);
+            }
+        }
+        pos = eol + 1;
+    }
+    return (pos < end ? pos : end) - begin;
+}
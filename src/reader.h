@@ -0,0 +1,220 @@
+#ifndef SANS_READER_H
+#define SANS_READER_H
+
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <zlib.h>
+
+
+using namespace std;
+
+/**
+ * This class reads FASTA and FASTQ files block-wise.
+ * Plain files are memory-mapped, compressed files are inflated in large blocks.
+ * Sequence lines are handed out as spans into the current block, i.e., without copying.
+ *
+ * BGZF and multi-member gzip files consist of independent members, which are inflated
+ * in parallel batches and handed to the parser in order. Files with a single member are
+ * inflated sequentially.
+ */
+class reader {
+
+private:
+
+    /**
+     * This is the size of an inflate block.
+     */
+    static const uint64_t block_size = 1ull << 22;
+
+    /**
+     * This is the max. compressed size of a gzip member that is inflated as a whole (larger ones are streamed).
+     */
+    static const uint64_t member_limit = 1ull << 24;
+
+    /**
+     * This is the amount of inflated data per thread and batch of gzip members.
+     */
+    static const uint64_t batch_size = 1ull << 21;
+
+    /**
+     * This is a gzip member: compressed range and inflated size (as given by its trailer).
+     */
+    struct member {
+        uint64_t begin;
+        uint64_t end;
+        uint64_t size;
+    };
+
+    /**
+     * This is a batch of consecutive gzip members and their inflated content.
+     */
+    struct batch {
+        vector<member> members;
+        vector<uint64_t> offsets;    // position of each member in data (and the total size at the end)
+        vector<char> data;
+        uint64_t valid;    // number of leading members that were inflated correctly
+    };
+
+    /**
+     * This is the name of the file (for error messages).
+     */
+    string file_name;
+
+    /**
+     * This is the memory-mapped content of a plain or compressed file.
+     */
+    char* map;
+    uint64_t map_size;
+    bool compressed;
+
+    /**
+     * This is the zlib handle of a file that cannot be mapped (e.g., a pipe).
+     */
+    gzFile gz_file;
+
+    /**
+     * This is an incomplete line at the end of the previous block.
+     */
+    string carry;
+
+    /**
+     * This flag indicates that the next line holds FASTQ quality values.
+     */
+    bool skip_quality;
+
+    /**
+     * This function parses all complete lines of a block.
+     *
+     * @param begin first character of the block
+     * @param end end of the block
+     * @param last true, if the block ends with the file (the last line may lack a newline)
+     * @param skip_quality true, if the next line holds FASTQ quality values
+     * @param record function called at each FASTA/FASTQ header
+     * @param sequence function called for each sequence line
+     * @return number of characters consumed
+     */
+    uint64_t parse(const char* begin, const char* end, bool last, bool& skip_quality, const function<void()>& record, const function<void(const char*, const uint64_t&)>& sequence);
+
+    /**
+     * This function parses the next block of the file, continuing an incomplete line of the previous block.
+     *
+     * @param begin first character of the block
+     * @param end end of the block
+     * @param record function called at each FASTA/FASTQ header
+     * @param sequence function called for each sequence line
+     */
+    void feed(const char* begin, const char* end, const function<void()>& record, const function<void(const char*, const uint64_t&)>& sequence);
+
+    /**
+     * This function determines the gzip member starting at the given position of the mapped file.
+     * BGZF blocks state their size, otherwise the member ends where the next gzip header is found.
+     *
+     * @param offset position in the compressed file
+     * @param next the member
+     * @return true, if the member is small enough to be inflated as a whole
+     */
+    bool next_member(const uint64_t& offset, member& next);
+
+    /**
+     * This function collects consecutive gzip members for one batch.
+     *
+     * @param offset position of the first member, updated to the end of the batch
+     * @param next the batch
+     * @return number of members
+     */
+    uint64_t collect(uint64_t& offset, batch& next);
+
+    /**
+     * This function inflates all members of a batch using several threads.
+     *
+     * @param current the batch
+     */
+    void inflate_batch(batch& current);
+
+    /**
+     * This function inflates the mapped file from the given position on in one stream.
+     *
+     * @param offset position in the compressed file
+     * @param record function called at each FASTA/FASTQ header
+     * @param sequence function called for each sequence line
+     */
+    void inflate_stream(const uint64_t& offset, const function<void()>& record, const function<void(const char*, const uint64_t&)>& sequence);
+
+public:
+
+    /**
+     * This is the size of the chunks of a memory-mapped file that are processed concurrently.
+     */
+    static const uint64_t chunk_size = 1ull << 24;
+
+    /**
+     * This is the number of threads inflating the members of a BGZF or multi-member gzip file.
+     */
+    static uint64_t threads;
+
+    /**
+     * This function opens a file, memory-mapped if possible, otherwise via zlib.
+     *
+     * @param file_name name of the file
+     */
+    reader(const string& file_name);
+
+    /**
+     * This function releases the mapping or the zlib handle.
+     */
+    ~reader();
+
+    /**
+     * This function tells whether the file could be opened.
+     *
+     * @return true, if the file is readable
+     */
+    bool good();
+
+    /**
+     * This function tells whether the file is memory-mapped and not compressed, i.e., it can be split into chunks.
+     *
+     * @return true, if chunks of the file can be read concurrently
+     */
+    bool mapped();
+
+    /**
+     * This function reads the whole file and hands out headers and sequence lines.
+     * FASTQ quality lines are skipped, empty lines are ignored.
+     *
+     * @param record function called at each FASTA/FASTQ header
+     * @param sequence function called for each sequence line (not upper-cased, without newline)
+     */
+    void read(const function<void()>& record, const function<void(const char*, const uint64_t&)>& sequence);
+
+    /**
+     * This function splits a memory-mapped plain file into chunks of whole lines.
+     * FASTQ files, or if requested also FASTA files, are split at record headers only.
+     * Other files form a single chunk.
+     *
+     * @param size min. size of a chunk
+     * @param records true, if each chunk has to start with a record header
+     * @return chunk boundaries (first and last are the file's begin and end)
+     */
+    vector<uint64_t> split(const uint64_t& size, const bool& records);
+
+    /**
+     * This function reads the lines of one chunk and hands out headers and sequence lines.
+     * If the chunk ends within a sequence, the sequence is continued for the given number of characters,
+     * such that all k-mers starting in the chunk are complete. Files that are not memory-mapped are read as a whole.
+     *
+     * @param begin begin of the chunk
+     * @param end end of the chunk
+     * @param overlap number of sequence characters to read beyond the chunk (i.e., k-1)
+     * @param record function called at each FASTA/FASTQ header
+     * @param sequence function called for each sequence line (not upper-cased, without newline)
+     */
+    void read(const uint64_t& begin, const uint64_t& end, const uint64_t& overlap, const function<void()>& record, const function<void(const char*, const uint64_t&)>& sequence);
+
+};
+
+#endif
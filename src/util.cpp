@@ -1,59 +1,6 @@
 #include "util.h"
 
 
-/**
- * This function compares the number of input genomes (n) to the compile parameter DmaxN (maxN).
- * Exits (code 3) if they disagree (too much) and a re-compilation is necessary (n>maxN) or recommended (n much smaller maxN).
- *
- * @param n number of input genomes
- * @return nothing
- */ 
-void util::check_n(uint64_t& n, string& path, const uint64_t& max_N) {
-	bool recompile = false;
-	if (n>max_N) {
-		cout << "Recompilation with DmaxN>=" << n << " necessary! (See " << path << "_autoN.)" << endl;
-		recompile = true;
-	} else if (max_N-n>=100) {
-		cout << "Recompilation with DmaxN=" << n << " recommended. (See " << path << "_autoN.)" << endl;
-		recompile = true;
-	}
-	if (recompile) {
-		cout << "DmaxN\t" << max_N << endl;
-		cout << "num\t" << n << endl;
-		
-		// open new makefile
-		ofstream file(path+"_autoN");
-		ostream newfilebuf(file.rdbuf());
-
-		// open original make file
-        ifstream infile(path);
-        if (!infile.good()) {
-            cerr << "Error: could not read makefile: "<< path << endl;
-            exit(1);
-        }
-        
-        // copy while replacing value for DmaxN and dependency on makefile
-        regex ren("-DmaxN=[0-9]+");
-        regex rem("makefile");
-		string line,new_line;
-        while (getline(infile, line)) {
-			new_line=regex_replace(line, ren, "-DmaxN="+to_string(n));
-			new_line=regex_replace(new_line, rem, "makefile_autoN");
-			newfilebuf << new_line << endl;
-		}
-		
- 		infile.close();
-		file.close();
-		
-		// stop SANS
-		exit(3);
-	
-	}
-}
-
-
-
-
 /**
  * This function calculates the arithmetic mean of two values.
  *
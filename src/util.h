@@ -23,16 +23,6 @@ private:
 
 public:
 
-    /**
-	* This function compares the number of input genomes (n) to the compile parameter DmaxN (maxN).
-	* Produces new makefile and exits (code 3) if they disagree (too much) and a re-compilation is necessary (n>maxN) or recommended (n much smaller maxN).
-	*
-	* @param n number of input genomes
-	* @return nothing
-	*/ 
-	static void check_n(uint64_t& n, string &path, const uint64_t& max_N);
-
-
     /**
      * This function calculates the arithmetic mean of two values.
      *
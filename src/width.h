@@ -0,0 +1,27 @@
+#ifndef SANS_WIDTH_H
+#define SANS_WIDTH_H
+
+
+/**
+ * The k-mer and color dependent code is compiled once per max. k-mer length (maxK) and number of colors (maxN),
+ * if WIDTHS is defined (see makefile). Each such instance is placed in its own namespace, and the instance that
+ * fits the input is chosen at runtime (see dispatch). Otherwise, the namespace macros are empty.
+ * The k-mer code only depends on maxK, it is compiled once per max. k-mer length and shared by the instances.
+ */
+#if defined(WIDTHS)
+    #define KMER_NAME(k)       KMER_CONCAT(k)
+    #define KMER_CONCAT(k)     width_##k
+    #define BEGIN_KMER         namespace KMER_NAME(maxK) {
+    #define END_KMER           }
+    #define WIDTH_NAME(k, n)   WIDTH_CONCAT(k, n)
+    #define WIDTH_CONCAT(k, n) width_##k##_##n
+    #define BEGIN_WIDTH        namespace KMER_NAME(maxK) {} namespace WIDTH_NAME(maxK, maxN) { using namespace KMER_NAME(maxK);
+    #define END_WIDTH          }
+#else
+    #define BEGIN_KMER
+    #define END_KMER
+    #define BEGIN_WIDTH
+    #define END_WIDTH
+#endif
+
+#endif